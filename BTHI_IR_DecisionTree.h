@@ -0,0 +1,712 @@
+/*---------------------------------------------------------------------------
+ * Streaming Infrared Decoder Library
+ *
+ * Copyright (c) 2013, Bryan Thomas (BTHI) and Christopher Myers
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *---------------------------------------------------------------------------
+ *
+ * IR_DecisionTree and IR_DecisionTreeStreamDecoder, which compile a set of
+ * pulse distance protocols into a search over their preambles. They're
+ * built from variadic templates, so unlike BTHI_IR_Decoder.h this header
+ * needs C++11 (which every Arduino IDE since 1.6.6 uses). Only include it
+ * if you use them.
+ */
+
+#ifndef BTHI_IR_DECISION_TREE_H
+#define BTHI_IR_DECISION_TREE_H
+
+#include <BTHI_IR_Decoder.h>
+
+#if __cplusplus < 201103L
+#error "BTHI_IR_DecisionTree.h needs C++11"
+#endif
+
+/**
+ * One entry of an IR_DecisionTree: a pulse distance protocol descriptor
+ * (see IR_ProtocolSamsung) and the id to report for it.
+ */
+template <class Protocol, uint8_t Id>
+struct IR_TreeProtocol : public Protocol {
+	typedef Protocol protocol_t;
+	static const uint8_t protocol_id = Id;
+};
+
+/**
+ * The machinery IR_DecisionTree is built from. Each protocol gives the tree
+ * two preambles, 2 * i for its header and 2 * i + 1 for its repeat frame,
+ * and a set of them is a mask with those bits. The tree first searches the
+ * header mark, then the header space, for which preambles they fit:
+ *
+ *  - A stage is the windows of one segment (0 the mark, 1 the space) of the
+ *    preambles in a set. Their edges, sorted, cut the tick counts into
+ *    intervals in which the same preambles fit. That's all done here by
+ *    the compiler.
+ *  - IR_TreeNode is a binary search of those edges, unrolled into nested
+ *    compares against constants. A mark's interval says which preambles
+ *    are left, and each interval has its own search of just their spaces.
+ *
+ * So a frame costs about log2 of the number of intervals in compares per
+ * segment, rather than two per window per protocol.
+ */
+#define IR_TREE_NO_POINT                0x10000UL
+
+template <class... Protocols>
+struct IR_TreeList {
+	static const uint8_t size = sizeof...(Protocols);
+};
+
+template <class List, uint8_t I>
+struct IR_TreeAt;
+
+template <class First, class... Rest>
+struct IR_TreeAt<IR_TreeList<First, Rest...>, 0> {
+	typedef First type;
+};
+
+template <uint8_t I, class First, class... Rest>
+struct IR_TreeAt<IR_TreeList<First, Rest...>, I> {
+	typedef typename IR_TreeAt<IR_TreeList<Rest...>, I - 1>::type type;
+};
+
+template <class Windows, uint8_t Stage, uint8_t Repeat>
+struct IR_TreeSegment {
+	typedef typename Windows::HeaderMark type;
+};
+
+template <class Windows>
+struct IR_TreeSegment<Windows, 0, 1> {
+	typedef typename Windows::RepeatMark type;
+};
+
+template <class Windows>
+struct IR_TreeSegment<Windows, 1, 0> {
+	typedef typename Windows::HeaderSpace type;
+};
+
+template <class Windows>
+struct IR_TreeSegment<Windows, 1, 1> {
+	typedef typename Windows::RepeatSpace type;
+};
+
+/* Preamble A's window for a stage, if it has one */
+template <class List, uint8_t Stage, uint8_t A>
+struct IR_TreeWindow {
+	typedef typename IR_TreeAt<List, (A >> 1)>::type::protocol_t Protocol;
+	typedef typename IR_TreeSegment<IR_PulseDistanceWindows<Protocol>,
+		Stage, (A & 1)>::type Window;
+
+	static const uint8_t valid =
+		(0 == (A & 1)) || (Protocol::repeat_mark_us != 0);
+};
+
+/* Edge J of the windows in Filter: the lo of window J / 2 if J is even,
+ * one past its hi if it's odd.
+ */
+template <class List, uint8_t Stage, uint32_t Filter, uint8_t J>
+struct IR_TreeRawPoint {
+	typedef IR_TreeWindow<List, Stage, (J >> 1)> Preamble;
+
+	static const uint32_t value = ((0 == Preamble::valid)
+			|| (0 == ((Filter >> (J >> 1)) & 1))) ? IR_TREE_NO_POINT
+		: (0 != (J & 1)) ? (uint32_t)Preamble::Window::hi + 1
+		: (uint32_t)Preamble::Window::lo;
+};
+
+/* The smallest edge above Above */
+template <class List, uint8_t Stage, uint32_t Filter, uint32_t Above,
+		uint8_t J = 0, uint8_t end = (J >= 4 * List::size)>
+struct IR_TreeNextPoint {
+	static const uint32_t raw =
+		IR_TreeRawPoint<List, Stage, Filter, J>::value;
+	static const uint32_t rest =
+		IR_TreeNextPoint<List, Stage, Filter, Above, J + 1>::value;
+	static const uint32_t value = ((raw > Above) && (raw < rest)) ? raw
+		: rest;
+};
+
+template <class List, uint8_t Stage, uint32_t Filter, uint32_t Above,
+		uint8_t J>
+struct IR_TreeNextPoint<List, Stage, Filter, Above, J, 1> {
+	static const uint32_t value = IR_TREE_NO_POINT;
+};
+
+/* The K-th smallest edge, IR_TREE_NO_POINT past the last */
+template <class List, uint8_t Stage, uint32_t Filter, uint8_t K>
+struct IR_TreePoint {
+	static const uint32_t value = IR_TreeNextPoint<List, Stage, Filter,
+		IR_TreePoint<List, Stage, Filter, K - 1>::value>::value;
+};
+
+template <class List, uint8_t Stage, uint32_t Filter>
+struct IR_TreePoint<List, Stage, Filter, 0> {
+	static const uint32_t value =
+		IR_TreeNextPoint<List, Stage, Filter, 0>::value;
+};
+
+template <class List, uint8_t Stage, uint32_t Filter, uint8_t K = 0,
+		uint8_t end = (IR_TreePoint<List, Stage, Filter, K>::value
+			== IR_TREE_NO_POINT)>
+struct IR_TreeNumPoints {
+	static const uint8_t value =
+		IR_TreeNumPoints<List, Stage, Filter, K + 1>::value;
+};
+
+template <class List, uint8_t Stage, uint32_t Filter, uint8_t K>
+struct IR_TreeNumPoints<List, Stage, Filter, K, 1> {
+	static const uint8_t value = K;
+};
+
+/* The preambles in Filter whose window holds At ticks */
+template <class List, uint8_t Stage, uint32_t Filter, uint32_t At,
+		uint8_t A = 0, uint8_t end = (A >= 2 * List::size)>
+struct IR_TreeMaskAt {
+	typedef IR_TreeWindow<List, Stage, A> Preamble;
+
+	static const uint32_t value = (((0 != Preamble::valid)
+			&& (0 != ((Filter >> A) & 1))
+			&& (At >= Preamble::Window::lo) && (At <= Preamble::Window::hi))
+				? (1UL << A) : 0)
+		| IR_TreeMaskAt<List, Stage, Filter, At, A + 1>::value;
+};
+
+template <class List, uint8_t Stage, uint32_t Filter, uint32_t At,
+		uint8_t A>
+struct IR_TreeMaskAt<List, Stage, Filter, At, A, 1> {
+	static const uint32_t value = 0;
+};
+
+/* Interval I runs from edge I - 1 (or 0) up to edge I */
+template <class List, uint8_t Stage, uint32_t Filter, uint8_t I>
+struct IR_TreeIntervalStart {
+	static const uint32_t value =
+		IR_TreePoint<List, Stage, Filter, I - 1>::value;
+};
+
+template <class List, uint8_t Stage, uint32_t Filter>
+struct IR_TreeIntervalStart<List, Stage, Filter, 0> {
+	static const uint32_t value = 0;
+};
+
+/* The preambles that fit anywhere in interval I */
+template <class List, uint8_t Stage, uint32_t Filter, uint8_t I>
+struct IR_TreeIntervalMask {
+	static const uint32_t value = IR_TreeMaskAt<List, Stage, Filter,
+		IR_TreeIntervalStart<List, Stage, Filter, I>::value>::value;
+};
+
+template <class List, uint8_t Stage, uint32_t Filter>
+struct IR_TreeStage {
+	typedef List list_t;
+	typedef typename IR_PreambleMask<2 * List::size>::type mask_t;
+
+	static const uint8_t stage = Stage;
+	static const uint32_t filter = Filter;
+	static const uint8_t num_points =
+		IR_TreeNumPoints<List, Stage, Filter>::value;
+
+	/* For looking at the tree, see ir_trace_tool's tree command */
+	template <uint8_t I>
+	struct Interval {
+		static const uint32_t start =
+			IR_TreeIntervalStart<List, Stage, Filter, I>::value;
+		static const uint32_t mask =
+			IR_TreeIntervalMask<List, Stage, Filter, I>::value;
+	};
+};
+
+template <class Stage, uint8_t I, uint8_t last = Stage::stage>
+struct IR_TreeLeaf;
+
+/* Searches intervals Lo to Hi of a stage. find() takes this stage's
+ * segment and the next one, and returns the preambles both fit.
+ */
+template <class Stage, uint8_t Lo, uint8_t Hi, uint8_t leaf = (Lo == Hi)>
+struct IR_TreeNode {
+	typedef typename Stage::mask_t mask_t;
+	typedef mask_t (*next_t)(uint16_t ticks);
+
+	static const uint8_t mid = (Lo + Hi + 1) / 2;
+	static const uint16_t point = (uint16_t)IR_TreePoint<
+		typename Stage::list_t, Stage::stage, Stage::filter, mid - 1>::value;
+
+	typedef IR_TreeNode<Stage, Lo, mid - 1> Below;
+	typedef IR_TreeNode<Stage, mid, Hi> Above;
+
+	static inline mask_t find(uint16_t ticks, uint16_t next) {
+		return (ticks < point) ? Below::find(ticks, next)
+			: Above::find(ticks, next);
+	}
+
+	/* The search of the next stage that this segment leads to, NULL if no
+	 * preamble fits. For decoding an edge at a time.
+	 */
+	static inline next_t findNext(uint16_t ticks) {
+		return (ticks < point) ? Below::findNext(ticks)
+			: Above::findNext(ticks);
+	}
+
+	/* How many compares find() makes */
+	static uint8_t countCompares(uint16_t ticks, uint16_t next) {
+		return 1 + ((ticks < point) ? Below::countCompares(ticks, next)
+			: Above::countCompares(ticks, next));
+	}
+};
+
+template <class Stage, uint8_t Lo, uint8_t Hi>
+struct IR_TreeNode<Stage, Lo, Hi, 1> : public IR_TreeLeaf<Stage, Lo> {
+};
+
+/* A header mark interval: search the spaces of what's left */
+template <class Stage, uint8_t I>
+struct IR_TreeLeaf<Stage, I, 0> {
+	typedef typename Stage::mask_t mask_t;
+	typedef mask_t (*next_t)(uint16_t ticks);
+
+	static const uint32_t mask = IR_TreeIntervalMask<typename Stage::list_t,
+		Stage::stage, Stage::filter, I>::value;
+
+	typedef IR_TreeStage<typename Stage::list_t, 1, mask> Next;
+	typedef IR_TreeNode<Next, 0, Next::num_points> NextRoot;
+
+	static inline mask_t find(uint16_t, uint16_t next) {
+		return NextRoot::find(next, 0);
+	}
+
+	static mask_t findSpace(uint16_t ticks) {
+		return NextRoot::find(ticks, 0);
+	}
+
+	static inline next_t findNext(uint16_t) {
+		return (0 == mask) ? NULL : findSpace;
+	}
+
+	static uint8_t countCompares(uint16_t, uint16_t next) {
+		return NextRoot::countCompares(next, 0);
+	}
+};
+
+/* A header space interval: done */
+template <class Stage, uint8_t I>
+struct IR_TreeLeaf<Stage, I, 1> {
+	typedef typename Stage::mask_t mask_t;
+
+	static const uint32_t mask = IR_TreeIntervalMask<typename Stage::list_t,
+		Stage::stage, Stage::filter, I>::value;
+
+	static inline mask_t find(uint16_t, uint16_t) {
+		return (mask_t)mask;
+	}
+
+	static uint8_t countCompares(uint16_t, uint16_t) {
+		return 0;
+	}
+};
+
+/* Runs the decoders of the preambles a frame fits, from preamble A up,
+ * until one decodes it.
+ */
+template <class List, uint8_t A = 0, uint8_t end = (A >= 2 * List::size)>
+struct IR_TreeDecoders {
+	typedef typename IR_TreeAt<List, (A >> 1)>::type Entry;
+	typedef typename Entry::protocol_t Protocol;
+	typedef IR_PulseDistanceWindows<Protocol> Windows;
+
+	static int8_t decodePreamble(const ir_segment_t *segments, uint8_t count,
+			ir_decode_result_t *result) {
+		/* The same checks as checkFramePulseDistance(), less the header */
+		if (0 != (A & 1)) {
+			if ((count >= Windows::repeat_segments)
+					&& (count < Windows::frame_segments)
+					&& Windows::BitMark::match(segments[2].duration)) {
+				return decodeResultRepeatPulseDistance<Protocol>(segments,
+					result);
+			}
+			return (count < Windows::frame_segments) ? IR_E_SHORT_FRAME
+				: IR_E_INVALID_START_OF_FRAME;
+		}
+
+		if (count < Windows::frame_segments) {
+			return IR_E_SHORT_FRAME;
+		}
+		if ((Protocol::trailer_mark_us != 0) && (Protocol::num_bits != 0)
+				&& !Windows::TrailerMark::match(
+					segments[Windows::frame_segments - 1].duration)) {
+			return IR_E_INVALID_END_OF_FRAME;
+		}
+		return decodeResultBodyPulseDistance<Protocol>(segments, count,
+			Entry::protocol_id, result);
+	}
+
+	template <class mask_t>
+	static int8_t decode(const ir_segment_t *segments, uint8_t count,
+			mask_t candidates, ir_decode_result_t *result, int8_t res) {
+		int8_t candidate_res;
+
+		if (0 != (candidates & ((mask_t)1 << A))) {
+			candidate_res = decodePreamble(segments, count, result);
+			if (IR_E_OK <= candidate_res) {
+				return candidate_res;
+			}
+			/* Report why the first candidate failed */
+			if (IR_E_INVALID_START_OF_FRAME == res) {
+				res = candidate_res;
+			}
+		}
+
+		return IR_TreeDecoders<List, A + 1>::decode(segments, count,
+			candidates, result, res);
+	}
+
+	/* The same as decodePreamble(), a segment at a time from segment 2 on */
+	static inline uint8_t segmentEvent(uint8_t segment, uint16_t duration,
+			uint32_t *data) {
+		if (0 != (A & 1)) {
+			return Windows::BitMark::match(duration) ? IR_MACHINE_REPEAT
+				: IR_MACHINE_REJECT;
+		}
+
+		if (segment < 2 + (2 * IR_FixedNumBits<Protocol>::value)) {
+			if (0 == (segment & 1)) {
+				return Windows::BitMark::match(duration) ? IR_MACHINE_BUSY
+					: IR_MACHINE_REJECT;
+			}
+
+			*data <<= 1;
+			if (!Windows::ZeroSpace::match(duration)) {
+				*data |= 1;
+			}
+
+			if ((Protocol::trailer_mark_us == 0)
+					&& (segment
+						== 1 + (2 * IR_FixedNumBits<Protocol>::value))) {
+				return IR_MACHINE_ACCEPT;
+			}
+			return IR_MACHINE_BUSY;
+		}
+
+		return Windows::TrailerMark::match(duration) ? IR_MACHINE_ACCEPT
+			: IR_MACHINE_REJECT;
+	}
+
+	/* Hands a segment to each live preamble from A up. Those that reject
+	 * it are cleared from live.
+	 *
+	 * Return: The first preamble to accept the frame or see a repeat, or
+	 *      0xFF if none did.
+	 */
+	template <class mask_t>
+	static inline uint8_t step(uint8_t segment, uint16_t duration,
+			mask_t *live, uint32_t *data) {
+		uint8_t res;
+
+		if (0 != (*live & ((mask_t)1 << A))) {
+			res = segmentEvent(segment, duration, &data[A >> 1]);
+			if (IR_MACHINE_REJECT == res) {
+				*live &= (mask_t)~((mask_t)1 << A);
+			} else if (IR_MACHINE_BUSY != res) {
+				return A;
+			}
+		}
+
+		return IR_TreeDecoders<List, A + 1>::step(segment, duration, live,
+			data);
+	}
+};
+
+template <class List, uint8_t A>
+struct IR_TreeDecoders<List, A, 1> {
+	template <class mask_t>
+	static int8_t decode(const ir_segment_t *, uint8_t, mask_t,
+			ir_decode_result_t *, int8_t res) {
+		return res;
+	}
+
+	template <class mask_t>
+	static inline uint8_t step(uint8_t, uint16_t, mask_t *, uint32_t *) {
+		return 0xFF;
+	}
+};
+
+/**
+ * A set of pulse distance protocols compiled into one decision tree. The
+ * compiler sorts the edges of every header mark and header space window
+ * and builds a binary search of them, so telling the protocols apart takes
+ * about log2 of the number of distinct windows in compares, and each
+ * compare is against a constant. Only the decoders of the preambles found
+ * then run. IR_PreambleDispatcher does the same with tables you fill in at
+ * run time; this needs no RAM at all but the set is fixed.
+ *
+ * Example:
+ *
+ *  typedef IR_DecisionTree<
+ *      IR_TreeProtocol<IR_ProtocolSamsung, IR_PROTOCOL_SAMSUNG>,
+ *      IR_TreeProtocol<IR_ProtocolApple, IR_PROTOCOL_APPLE> > Tree;
+ *  ...
+ *  if (decoder.isFrameAvailable()) {
+ *      res = Tree::decode(&decoder, &result, millis());
+ *      ...
+ *  }
+ *
+ * Where two protocols' preambles overlap (Samsung's and Apple's repeat
+ * frames, say), both decoders are run, in the order listed, and the first
+ * that decodes the frame wins. Up to 16 protocols. See
+ * IR_DecisionTreeStreamDecoder for decoding the frame as it arrives.
+ *
+ * The list is a variadic template, so this needs C++11, which the Arduino
+ * IDE has compiled with since 1.6.6.
+ */
+template <class... Protocols>
+class IR_DecisionTree {
+public:
+	typedef IR_TreeList<Protocols...> list_t;
+	typedef IR_TreeStage<list_t, 0, (2 * list_t::size >= 32) ? 0xFFFFFFFFUL
+		: ((1UL << (2 * list_t::size)) - 1)> MarkStage;
+	typedef typename MarkStage::mask_t mask_t;
+	typedef IR_TreeNode<MarkStage, 0, MarkStage::num_points> Root;
+
+	/**
+	 * The preambles a header fits: bit 2 * i for protocol i's header and
+	 * 2 * i + 1 for its repeat frame.
+	 */
+	static inline mask_t getCandidates(uint16_t mark, uint16_t space) {
+		return Root::find(mark, space);
+	}
+
+	/* How many compares getCandidates() makes for a header */
+	static uint8_t countCompares(uint16_t mark, uint16_t space) {
+		return Root::countCompares(mark, space);
+	}
+
+	/**
+	 * Decodes a frame with whichever protocol the tree picks.
+	 *
+	 * Parameters:
+	 *      segments: The recorded segments, starting with the header mark.
+	 *      count: The number of segments recorded.
+	 *      result: Filled in, see ir_decode_result_t. protocol is the
+	 *          protocol_id of the IR_TreeProtocol that decoded it.
+	 *      timestamp: Copied to result->timestamp.
+	 *
+	 * Return: As decodeFrameAny(). IR_E_INVALID_START_OF_FRAME if no
+	 *      protocol's preamble fits.
+	 */
+	static int8_t decode(const ir_segment_t *segments, uint8_t count,
+			ir_decode_result_t *result, uint32_t timestamp = 0) {
+		result->timestamp = timestamp;
+		result->flags = 0;
+		result->quality = 0;
+
+		if (count < 2) {
+			return IR_E_SHORT_FRAME;
+		}
+
+		return IR_TreeDecoders<list_t>::decode(segments, count,
+			getCandidates(segments[0].duration, segments[1].duration),
+			result, (int8_t)IR_E_INVALID_START_OF_FRAME);
+	}
+
+	static int8_t decode(IR_BufferingStreamDecoder *bufferedDecoder,
+			ir_decode_result_t *result, uint32_t timestamp = 0) {
+		return decode(bufferedDecoder->getSegmentBuffer(),
+			bufferedDecoder->getSegmentCount(), result, timestamp);
+	}
+
+	static int8_t decode(const ir_frame_view_t *frame,
+			ir_decode_result_t *result, uint32_t timestamp = 0) {
+		return decode(frame->segments, frame->count, result, timestamp);
+	}
+};
+
+/**
+ * IR_DecisionTree a segment at a time, as a decoder delegate. The header
+ * mark picks which search the space goes to, the space picks the protocols
+ * still in the running, and from then on each segment only goes to those,
+ * usually just one. It keeps a 32-bit payload per protocol and nothing
+ * else, and is defined here in the header, so with IR_StaticHwInterface the
+ * whole tree is inlined into the capture ISR:
+ *
+ *  typedef IR_DecisionTreeStreamDecoder<
+ *      IR_TreeProtocol<IR_ProtocolSamsung, IR_PROTOCOL_SAMSUNG>,
+ *      IR_TreeProtocol<IR_ProtocolApple, IR_PROTOCOL_APPLE> > TreeDecoder;
+ *  TreeDecoder decoder;
+ *  IR_StaticHwInterface<TreeDecoder> hw;
+ *  IR_STATIC_HW_INTERFACE_ISRS(hw)
+ *
+ * It reports frames the way IR_StreamDispatcher does: as soon as the last
+ * segment arrives, with repeat frames as a repeat of the last frame
+ * accepted. Protocols need num_bits from 1 to 32, as with
+ * IR_PulseDistanceStreamMachine.
+ */
+template <class... Protocols>
+class IR_DecisionTreeStreamDecoder : public IR_StreamDecoder {
+private:
+	typedef IR_DecisionTree<Protocols...> Tree;
+	typedef typename Tree::list_t list_t;
+	typedef typename Tree::mask_t mask_t;
+	typedef typename Tree::Root::next_t next_t;
+
+	uint32_t _payloads[list_t::size];
+	next_t _find_space;
+	mask_t _live;
+	uint8_t _segment;
+	uint8_t _first_edge;
+	uint8_t _frame_available;
+	uint8_t _unmatched_frames;
+
+	/* The preamble that matched, and the last frame accepted */
+	uint8_t _matched;
+	uint8_t _last_matched;
+	uint32_t _data;
+	uint8_t _repeat;
+
+	/* The protocol_id of an entry, from its index */
+	template <uint8_t I, uint8_t end = (I >= list_t::size)>
+	struct ProtocolId {
+		static inline uint8_t get(uint8_t index) {
+			return (I == index) ? IR_TreeAt<list_t, I>::type::protocol_id
+				: ProtocolId<I + 1>::get(index);
+		}
+	};
+
+	template <uint8_t I>
+	struct ProtocolId<I, 1> {
+		static inline uint8_t get(uint8_t) {
+			return IR_PROTOCOL_UNKNOWN;
+		}
+	};
+
+public:
+	IR_DecisionTreeStreamDecoder(void) {
+		_live = 0;
+		_find_space = NULL;
+		_segment = 0;
+		_first_edge = 1;
+		_frame_available = 0;
+		_unmatched_frames = 0;
+		_matched = 0xFF;
+		_last_matched = 0xFF;
+		_data = 0;
+		_repeat = 0;
+	}
+
+	void edgeEvent(uint16_t duration) {
+		uint8_t segment;
+		uint8_t preamble;
+
+		/* Don't touch the result until readyForNextFrame() */
+		if (0 != _frame_available) {
+			return;
+		}
+
+		if (0 != _first_edge) {
+			_first_edge = 0;
+			_segment = 0;
+			_live = 0;
+			_matched = 0xFF;
+			_repeat = 0;
+			return;
+		}
+
+		segment = _segment;
+		if (segment < 0xFF) {
+			_segment = segment + 1;
+		}
+
+		if (0 == segment) {
+			_find_space = Tree::Root::findNext(duration);
+			return;
+		} else if (1 == segment) {
+			_live = (NULL != _find_space) ? _find_space(duration) : 0;
+			for (uint8_t i = 0; i < list_t::size; i++) {
+				_payloads[i] = 0;
+			}
+			return;
+		} else if (0 == _live) {
+			return;
+		}
+
+		preamble = IR_TreeDecoders<list_t>::step(segment, duration, &_live,
+			_payloads);
+		if (0xFF == preamble) {
+			return;
+		}
+
+		if (0 == (preamble & 1)) {
+			/* Nobody else gets a say in this frame */
+			_matched = preamble >> 1;
+			_last_matched = _matched;
+			_data = _payloads[_matched];
+			_live = 0;
+			_frame_available = 1;
+		} else if (0xFF != _last_matched) {
+			_matched = _last_matched;
+			_repeat = 1;
+			_live = 0;
+			_frame_available = 1;
+		} else {
+			/* A repeat of nothing */
+			_live &= (mask_t)~((mask_t)1 << preamble);
+		}
+	}
+
+	void endOfFrameEvent(void) {
+		if (0 != _frame_available) {
+			return;
+		}
+
+		if ((0 == _first_edge) && (_unmatched_frames < (uint8_t)0xFF)) {
+			_unmatched_frames++;
+		}
+
+		_live = 0;
+		_first_edge = 1;
+	}
+
+	void readyForNextFrame(void) {
+		IR_HAL_DISABLE_INTERRUPTS();
+		_matched = 0xFF;
+		_live = 0;
+		_first_edge = 1;
+		_frame_available = 0;
+		IR_HAL_ENABLE_INTERRUPTS();
+	}
+
+	uint8_t isFrameAvailable(void) {
+		return _frame_available;
+	}
+
+	/* The protocol_id of the protocol that decoded the frame */
+	uint8_t getProtocol(void) {
+		return (0xFF == _matched) ? IR_PROTOCOL_UNKNOWN
+			: ProtocolId<0>::get(_matched);
+	}
+
+	uint32_t getData(void) {
+		return _data;
+	}
+
+	uint8_t isRepeatFrame(void) {
+		return _repeat;
+	}
+
+	uint8_t getUnmatchedFrameCount(void) {
+		return _unmatched_frames;
+	}
+};
+
+#endif
@@ -25,25 +25,101 @@
 #ifndef BTHI_IR_DECODER_H
 #define BTHI_IR_DECODER_H
 
+#if defined(ARDUINO)
 #include <platform.h>
+#else
+#include <stdint.h>
+#include <stddef.h>
+#endif
 #include <stdlib.h>
 
+/**
+ * Length of one Timer 1 tick in nanoseconds. IR_HwInterface::setup() runs
+ * the timer from the 16 MHz system clock with a /8 prescaler:
+ *
+ *      1 / (16000000 Hz / 8) = 0.5us = 500ns
+ */
+#define IR_TICK_PERIOD_NS   500
+
+/**
+ * Converts microseconds into a whole number of ticks using integer math only.
+ * IR_US_TO_TICKS rounds down and IR_US_TO_TICKS_CEIL rounds up. When the
+ * argument is a constant the compiler folds the whole thing away.
+ */
+#define IR_US_TO_TICKS(us) \
+    ((uint32_t)(us) * 1000UL / IR_TICK_PERIOD_NS)
+#define IR_US_TO_TICKS_CEIL(us) \
+    (((uint32_t)(us) * 1000UL + IR_TICK_PERIOD_NS - 1) / IR_TICK_PERIOD_NS)
+
 /**
  * This macro can tell you whether the duration in ticks corresponds to a
- * range of microseconds.
+ * range of microseconds. It is kept for existing sketches; new code should
+ * prefer IR_TickWindow below since it guarantees the bounds are computed at
+ * compile time.
  */
 #define IR_DURATION_MATCH_US(actual_ticks, expected_us, tolerance_us) \
     ( \
-    (actual_ticks >= ((expected_us - tolerance_us) * (1e-6 / 5e-7))) && \
-    (actual_ticks <= ((expected_us + tolerance_us) * (1e-6 / 5e-7))) \
+    ((actual_ticks) >= IR_US_TO_TICKS_CEIL((expected_us) - (tolerance_us))) && \
+    ((actual_ticks) <= IR_US_TO_TICKS((expected_us) + (tolerance_us))) \
     )
 
 /**
- * Return codes that can be used for decode routines.
+ * Compile-time window of acceptable tick counts for a segment that should
+ * last expected_us +/- tolerance_us. The bounds are integral constants, so a
+ * match is just two 16-bit compares with no floating point anywhere, which
+ * matters on the AVR where double math is done in software and some of
+ * these comparisons run inside the capture ISR.
+ *
+ * The lower bound is rounded up and the upper bound rounded down so that the
+ * window never accepts a duration outside of the requested range. Bounds
+ * are clamped to what fits in a 16-bit tick count.
+ *
+ * Example:
+ *
+ *  typedef IR_TickWindow<4500, 200> SamsungHeader;
+ *
+ *  if (SamsungHeader::match(segments[0].duration)) {
+ *      ...
+ *  }
+ */
+template <uint16_t expected_us, uint16_t tolerance_us,
+        uint16_t tick_period_ns = IR_TICK_PERIOD_NS>
+struct IR_TickWindow {
+	static const uint16_t lo = (expected_us <= tolerance_us) ? 0 :
+		(uint16_t)((((uint32_t)(expected_us - tolerance_us) * 1000UL)
+			+ tick_period_ns - 1) / tick_period_ns);
+
+	static const uint16_t hi =
+		((((uint32_t)expected_us + tolerance_us) * 1000UL / tick_period_ns)
+			> 0xFFFFUL) ? 0xFFFF :
+		(uint16_t)(((uint32_t)expected_us + tolerance_us) * 1000UL
+			/ tick_period_ns);
+
+	static inline uint8_t match(uint16_t ticks) {
+		return (ticks >= lo) && (ticks <= hi);
+	}
+};
+
+/**
+ * Keeps the compiler from moving memory accesses across this point. The AVR
+ * is single core, so this is all that's needed to make sure a frame is fully
+ * written before the index that publishes it (and vice versa).
+ */
+#define IR_MEMORY_BARRIER()     __asm__ __volatile__ ("" ::: "memory")
+
+/**
+ * Return codes that can be used for decode routines. IR_E_REPEAT isn't an
+ * error: the frame was the short code a remote sends while a key is held,
+ * meaning "the last code again". No data is decoded from it.
+ * IR_E_PAYLOAD_TOO_LONG means the frame holds more bits than the buffer it
+ * was to be decoded into.
  */
+#define IR_E_PAYLOAD_TOO_LONG           -4
+#define IR_E_INVALID_END_OF_FRAME       -3
 #define IR_E_INVALID_START_OF_FRAME     -2
 #define IR_E_SHORT_FRAME                -1
 #define IR_E_OK                         0
+#define IR_E_REPEAT                     1
 
 /* Structure to hold segment information. We used a structure so that if we
  * ran into a protocol that needed both the duration and level, we'd be able
@@ -53,6 +129,218 @@ typedef struct {
 	uint16_t duration;
 } ir_segment_t;
 
+/* Half-size alternative to ir_segment_t. duration holds the tick count as a
+ * tiny floating point number, 4 bits of exponent and 4 of mantissa, see
+ * irQuantizeTicks(). Durations keep 5 significant bits, which is within 3%
+ * everywhere from 16 ticks to 65535 and plenty to tell the segments of a
+ * protocol apart. The pulse distance decoders work on these directly.
+ */
+typedef struct {
+	uint8_t duration;
+} ir_qsegment_t;
+
+/**
+ * Converts a tick count to the 8-bit scale of ir_qsegment_t, rounding down.
+ * Counts below 32 are kept exactly (and the code is the count). Above that,
+ * each doubling of the duration adds 16 codes: the code is
+ * (exponent << 4) | mantissa for ticks = (16 + mantissa) << (exponent - 1).
+ * It's only shifts and compares, so it's cheap enough for the capture ISR.
+ *
+ * Parameters:
+ *      ticks: A duration in Timer 1 ticks.
+ *
+ * Return: The code, 0 to 207.
+ */
+inline uint8_t irQuantizeTicks(uint16_t ticks) {
+	uint8_t exponent = 1;
+
+	if (ticks < 16) {
+		return (uint8_t)ticks;
+	}
+
+	while (ticks >= 512) {
+		ticks >>= 4;
+		exponent += 4;
+	}
+	while (ticks >= 32) {
+		ticks >>= 1;
+		exponent++;
+	}
+
+	return (uint8_t)((exponent << 4) | (ticks & 0x0F));
+}
+
+/**
+ * The inverse of irQuantizeTicks(). Since codes stand for a range of tick
+ * counts, this returns the middle of the range.
+ *
+ * Parameters:
+ *      code: A code from irQuantizeTicks().
+ *
+ * Return: A duration in Timer 1 ticks.
+ */
+inline uint16_t irDequantizeTicks(uint8_t code) {
+	uint8_t exponent = code >> 4;
+
+	if (exponent <= 1) {
+		return code;
+	}
+
+	return (uint16_t)(((uint16_t)(0x10 | (code & 0x0F)) << (exponent - 1))
+		+ ((1U << (exponent - 1)) >> 1));
+}
+
+/* How buffering decoders store a duration in either kind of segment */
+inline void irStoreSegment(ir_segment_t *segment, uint16_t ticks) {
+	segment->duration = ticks;
+}
+
+inline void irStoreSegment(ir_qsegment_t *segment, uint16_t ticks) {
+	segment->duration = irQuantizeTicks(ticks);
+}
+
+/* And how long either kind of segment was, in ticks */
+inline uint16_t irSegmentTicks(const ir_segment_t *segment) {
+	return segment->duration;
+}
+
+inline uint16_t irSegmentTicks(const ir_qsegment_t *segment) {
+	return irDequantizeTicks(segment->duration);
+}
+
+/**
+ * What a segment becomes in a symbol stream (see IR_SymbolStreamDecoder).
+ * Most protocols only care which of a handful of lengths a segment is, so
+ * each one is classified as it arrives and stored in 2 bits.
+ */
+#define IR_SYMBOL_SHORT                 0
+#define IR_SYMBOL_LONG                  1
+#define IR_SYMBOL_HEADER                2
+#define IR_SYMBOL_OTHER                 3
+
+/* Bytes needed to hold num_symbols packed symbols */
+#define IR_SYMBOL_BYTES(num_symbols)    (((num_symbols) + 3) / 4)
+
+/* Upper bounds, in ticks, of each symbol. Anything shorter than short_min
+ * or longer than header_max is IR_SYMBOL_OTHER. Fill one in by hand, or with
+ * IR_SYMBOL_THRESHOLDS() from a protocol descriptor.
+ */
+typedef struct {
+	uint16_t short_min;
+	uint16_t short_max;
+	uint16_t long_max;
+	uint16_t header_max;
+} ir_symbol_thresholds_t;
+
+/**
+ * Classifies a duration against a threshold table. Three compares at most,
+ * so it's cheap enough for the capture ISR.
+ *
+ * Parameters:
+ *      thresholds: The table to classify against.
+ *      ticks: A duration in Timer 1 ticks.
+ *
+ * Return: One of the IR_SYMBOL_ values.
+ */
+inline uint8_t irClassifyTicks(const ir_symbol_thresholds_t *thresholds,
+		uint16_t ticks) {
+	if (ticks <= thresholds->short_max) {
+		return (ticks >= thresholds->short_min) ? IR_SYMBOL_SHORT
+			: IR_SYMBOL_OTHER;
+	} else if (ticks <= thresholds->long_max) {
+		return IR_SYMBOL_LONG;
+	} else if (ticks <= thresholds->header_max) {
+		return IR_SYMBOL_HEADER;
+	}
+
+	return IR_SYMBOL_OTHER;
+}
+
+/**
+ * Reads one symbol from a packed symbol stream. Symbols are packed four to a
+ * byte, the first in the low 2 bits, so a mark and the space after it share
+ * a nibble.
+ */
+inline uint8_t irGetSymbol(const uint8_t *symbols, uint16_t index) {
+	return (uint8_t)((symbols[index >> 2] >> ((index & 3) << 1)) & 0x03);
+}
+
+/* Bookkeeping for one frame slot of an IR_QueuedBufferingStreamDecoder. You
+ * only need to provide storage for these; the decoder fills them in.
+ */
+typedef struct {
+	uint8_t count;
+	uint8_t segment_overflows;
+} ir_frame_info_t;
+
+/* Protocol ids for ir_decode_result_t. Ids from IR_PROTOCOL_USER up are
+ * free for your own protocols.
+ */
+#define IR_PROTOCOL_UNKNOWN             0
+#define IR_PROTOCOL_SAMSUNG             1
+#define IR_PROTOCOL_APPLE               2
+#define IR_PROTOCOL_USER                0x80
+
+/* ir_decode_result_t flags */
+#define IR_RESULT_F_REPEAT              0x01
+
+/* Longest payload an ir_decode_result_t holds */
+#define IR_RESULT_PAYLOAD_BYTES         8
+
+/* Everything a decode found out about a frame, see decodeFrameAny().
+ *
+ *      timestamp: Whatever the caller passed in, typically millis() when
+ *          the frame was noticed.
+ *      address, command: For 32-bit frames, the first 16 bits and the third
+ *          byte, the layout NEC and its relatives (Samsung, Apple) use.
+ *          0 for other lengths.
+ *      payload: The bits as received, the first in the most significant bit
+ *          of payload[0], as with decodeFramePulseDistanceLong().
+ *      protocol: One of the IR_PROTOCOL_ ids.
+ *      num_bits: How many bits of payload are valid.
+ *      flags: IR_RESULT_F_REPEAT if the frame was a repeat frame. The
+ *          protocol and payload are then left as they were, so if you keep
+ *          passing the same result they still say what's being repeated.
+ *      quality: How close the segments were to their nominal lengths, from
+ *          100 (spot on) down to 0 (every segment at or past the edge of its
+ *          tolerance). A remote that's far away or low on battery shows up
+ *          here well before its frames stop decoding.
+ */
+typedef struct {
+	uint32_t timestamp;
+	uint16_t address;
+	uint16_t command;
+	uint8_t payload[IR_RESULT_PAYLOAD_BYTES];
+	uint8_t protocol;
+	uint8_t num_bits;
+	uint8_t flags;
+	uint8_t quality;
+} ir_decode_result_t;
+
+/**
+ * The first 32 bits of a result's payload as a number, the same as
+ * decodeFramePulseDistance() would have given.
+ */
+inline uint32_t irGetResultData(const ir_decode_result_t *result) {
+	uint32_t data = ((uint32_t)result->payload[0] << 24)
+		| ((uint32_t)result->payload[1] << 16)
+		| ((uint16_t)result->payload[2] << 8) | result->payload[3];
+
+	return (result->num_bits >= 32) ? data
+		: (0 == result->num_bits) ? 0 : (data >> (32 - result->num_bits));
+}
+
+/* A captured frame, lent to you by an IR_PooledBufferingStreamDecoder. It
+ * only points at the segments, so it's cheap to hand to decoders, loggers or
+ * anything else that needs the frame. Valid until it's returned.
+ */
+typedef struct {
+	const ir_segment_t *segments;
+	uint8_t count;
+	uint8_t segment_overflows;
+	uint8_t slot;
+} ir_frame_view_t;
+
 /* Enum to define the different polarity options we support. */
 typedef enum {
 	IR_POLARITY_LOW = 0,
@@ -60,6 +348,40 @@ typedef enum {
 	IR_POLARITY_AUTO
 } ir_polarity_t;
 
+/* Enum to define how Timer 1 measures the time between edges.
+ *
+ *   IR_TIMER_RESET_ON_EDGE: TCNT1 is cleared in the capture ISR. Every
+ *      duration comes up short by however long the ISR took to start.
+ *   IR_TIMER_FREE_RUNNING: Timer 1 is never touched and each duration is
+ *      ICR1 minus the previous ICR1. Exact, however late the ISR runs.
+ */
+typedef enum {
+	IR_TIMER_RESET_ON_EDGE = 0,
+	IR_TIMER_FREE_RUNNING
+} ir_timer_mode_t;
+
+/* Longest end-of-frame gap that fits in 16 bits of ticks */
+#define IR_MAX_END_OF_FRAME_US          32767
+
+/**
+ * Converts the end_of_frame_us given to setup() into the tick count the HAL
+ * wants. A gap longer than IR_MAX_END_OF_FRAME_US doesn't fit in 16 bits of
+ * ticks, so it gets the Timer 1 overflow instead (0), which at 32.768ms is as
+ * long as the gap can be.
+ *
+ * Parameters:
+ *      end_of_frame_us: The gap in microseconds, or 0 for the overflow.
+ *
+ * Return: The gap in ticks, or 0 for the overflow.
+ */
+inline uint16_t irEndOfFrameTicks(uint16_t end_of_frame_us) {
+	if (end_of_frame_us > IR_MAX_END_OF_FRAME_US) {
+		return 0;
+	}
+
+	return (uint16_t)IR_US_TO_TICKS(end_of_frame_us);
+}
+
 /**
  * Specifies the StreamDecoder interface which serves as the delegate to the
  * IR_HwInterface object. That is, this is the contract between the
@@ -67,8 +389,8 @@ typedef enum {
  */
 class IR_StreamDecoder {
 public:
-	virtual void edgeEvent(uint16_t duration);
-	virtual void endOfFrameEvent(void);
+	virtual void edgeEvent(uint16_t duration) = 0;
+	virtual void endOfFrameEvent(void) = 0;
 };
 
 /**
@@ -85,25 +407,54 @@ private:
 public:
 	IR_HwInterface();
 	void setup(IR_StreamDecoder *stream_decoder, uint8_t pin, 
-			ir_polarity_t polarity);
+			ir_polarity_t polarity, uint16_t end_of_frame_us = 0,
+			ir_timer_mode_t timer_mode = IR_TIMER_RESET_ON_EDGE);
 	void captureInterrupt();
 	void overflowInterrupt();
 };
 
+/* Most segment buffers an IR_BufferingStreamDecoder can switch between */
+#define IR_MAX_SEGMENT_BUFFERS          4
+
 /**
  * Decoder delegate implementation that buffers all of the waveform segments
  * it sees for later analysis instead of decoding them on the fly. This is
  * good for reverse engineering a protocol and serves as a
  * manufacturer-independent example that we can ship.
+ *
+ * With a single buffer (setSegmentBuffer()), frames that arrive while you
+ * are still looking at the last one are missed. Give it two or more with
+ * setSegmentBuffers() and it lends each complete frame to you in place and
+ * carries on capturing into a buffer it still owns; readyForNextFrame()
+ * hands the frame's buffer back. Nothing is copied either way.
+ *
+ * It holds at most 255 segments per frame. For longer frames, use
+ * IR_FixedBufferingStreamDecoder.
  */
 class IR_BufferingStreamDecoder : public IR_StreamDecoder {
 private:
 	ir_segment_t *_segments;
 	uint8_t _max_segments;
+	uint8_t _num_buffers;
+
+	/* Frames lent to the application, oldest first starting at
+	 * _read_buffer. _lent is only lowered with interrupts disabled.
+	 */
+	ir_frame_info_t _lent_frames[IR_MAX_SEGMENT_BUFFERS];
+	volatile uint8_t _lent;
+	uint8_t _read_buffer;
+
+	/* Capture (ISR) state */
+	ir_segment_t *_write_segments;
+	uint8_t _write_buffer;
 	uint8_t _count;
 	uint8_t _segment_overflows;
-	uint8_t _frame_complete;
 	uint8_t _first_edge;
+	uint8_t _published;
+	uint8_t _frame_segments;
+
+	void lendFrame(void);
+	void startBuffer(uint8_t buffer);
 
 public:
 	IR_BufferingStreamDecoder(void);
@@ -112,22 +463,1850 @@ public:
 
 	void setSegmentBuffer(ir_segment_t *segments, 
 		uint8_t num_segments);
+	void setSegmentBuffers(ir_segment_t *segments,
+		uint8_t segments_per_buffer, uint8_t num_buffers);
+	void setFrameLength(uint8_t num_segments);
     ir_segment_t *getSegmentBuffer(void);
 	void debugPrintFrame(void);
 	void readyForNextFrame(void);
 	uint8_t isFrameAvailable(void);
+	uint8_t getAvailableFrameCount(void);
 	uint8_t getSegmentCount(void);
 	uint8_t getSegmentOverflowCount(void);
 };
 
+/**
+ * Decoder delegate implementation that buffers several complete frames in a
+ * single-producer/single-consumer ring. The capture ISR is the producer and
+ * your loop() is the consumer. Frames that arrive while loop() is busy are
+ * queued instead of being thrown away, and the consumer side never has to
+ * disable interrupts.
+ *
+ * When every slot is occupied, the next frame is dropped as a whole and
+ * counted (see getDroppedFrameCount()).
+ *
+ * Give setFrameBuffer() an ir_qsegment_t array instead of ir_segment_t and
+ * durations are stored in 8 bits (see irQuantizeTicks()), so the same RAM
+ * queues twice as many frames. decodeFrameSamsung() and decodeFrameApple()
+ * handle either.
+ */
+class IR_QueuedBufferingStreamDecoder : public IR_StreamDecoder {
+private:
+	/* Only one of these is set, depending on the setFrameBuffer() used */
+	ir_segment_t *_segments;
+	ir_qsegment_t *_qsegments;
+	ir_frame_info_t *_frames;
+	uint8_t _segments_per_frame;
+	uint8_t _num_frames;
+
+	/* Free-running counts of frames published by the ISR and released by
+	 * the application. Each is written by only one side.
+	 */
+	volatile uint8_t _head;
+	volatile uint8_t _tail;
+	volatile uint8_t _dropped_frames;
+
+	/* Producer (ISR) state */
+	ir_segment_t *_write_segments;
+	ir_qsegment_t *_write_qsegments;
+	uint8_t _write_slot;
+	uint8_t _count;
+	uint8_t _segment_overflows;
+	uint8_t _first_edge;
+	uint8_t _dropping;
+	uint8_t _published;
+	uint8_t _frame_segments;
+
+	/* Consumer (loop) state */
+	uint8_t _read_slot;
+
+	void publishFrame(void);
+	void resetQueue(uint8_t segments_per_frame, ir_frame_info_t *frames,
+		uint8_t num_frames);
+
+public:
+	IR_QueuedBufferingStreamDecoder(void);
+	void edgeEvent(uint16_t duration);
+	void endOfFrameEvent(void);
+
+	void setFrameBuffer(ir_segment_t *segments,
+		uint8_t segments_per_frame, ir_frame_info_t *frames,
+		uint8_t num_frames);
+	void setFrameBuffer(ir_qsegment_t *segments,
+		uint8_t segments_per_frame, ir_frame_info_t *frames,
+		uint8_t num_frames);
+	void setFrameLength(uint8_t num_segments);
+	ir_segment_t *getSegmentBuffer(void);
+	ir_qsegment_t *getQuantizedSegmentBuffer(void);
+	void readyForNextFrame(void);
+	uint8_t isFrameAvailable(void);
+	uint8_t getQueuedFrameCount(void);
+	uint8_t getSegmentCount(void);
+	uint8_t getSegmentOverflowCount(void);
+	uint8_t getDroppedFrameCount(void);
+};
+
+/**
+ * Pulse distance protocols (NEC and its many relatives) all look the same on
+ * the wire: a header mark and space, then for every bit a fixed-length mark
+ * followed by a space whose length tells you if it's a 0 or a 1, and
+ * finally a trailing mark to terminate the last space.
+ *
+ * Rather than writing a decode loop for every remote, describe the protocol
+ * with a struct of compile-time constants like the ones below and hand it to
+ * decodeFramePulseDistance(). All of the fields are needed:
+ *
+ *      header_mark_us, header_space_us: The start of frame.
+ *      header_tolerance_us: How far off the header segments may be.
+ *      bit_mark_us: The first half of every bit.
+ *      zero_space_us, one_space_us: The second half of a 0 and a 1 bit.
+ *      bit_tolerance_us: How far off the bit segments may be.
+ *      num_bits: Payload length, 1 to 32. Sent most significant bit first.
+ *          decodeFramePulseDistanceLong() and decodeResultPulseDistance()
+ *          take any length, or 0 for frames whose length varies (which then
+ *          need a trailer mark). The 32-bit decoders don't compile for
+ *          those; see IR_FixedNumBits.
+ *      trailer_mark_us: The mark after the last bit, or 0 if there is none.
+ *      repeat_mark_us, repeat_space_us: The start of the repeat frame sent
+ *          while a key is held, which is followed by a single bit mark and
+ *          nothing else. Set repeat_mark_us to 0 if there isn't one. Checked
+ *          with header_tolerance_us.
+ */
+struct IR_ProtocolSamsung {
+	static const uint16_t header_mark_us = 4500;
+	static const uint16_t header_space_us = 4500;
+	static const uint16_t header_tolerance_us = 200;
+	static const uint16_t bit_mark_us = 560;
+	static const uint16_t zero_space_us = 560;
+	static const uint16_t one_space_us = 1690;
+	static const uint16_t bit_tolerance_us = 100;
+	static const uint8_t num_bits = 32;
+	static const uint16_t trailer_mark_us = 560;
+	static const uint16_t repeat_mark_us = 9000;
+	static const uint16_t repeat_space_us = 2250;
+};
+
+struct IR_ProtocolApple {
+	static const uint16_t header_mark_us = 9000;
+	static const uint16_t header_space_us = 4500;
+	static const uint16_t header_tolerance_us = 200;
+	static const uint16_t bit_mark_us = 600;
+	static const uint16_t zero_space_us = 600;
+	static const uint16_t one_space_us = 1690;
+	static const uint16_t bit_tolerance_us = 100;
+	static const uint8_t num_bits = 32;
+	static const uint16_t trailer_mark_us = 600;
+	static const uint16_t repeat_mark_us = 9000;
+	static const uint16_t repeat_space_us = 2250;
+};
+
+/**
+ * The tick windows for each segment of a pulse distance protocol descriptor.
+ * These are what the decoders actually compare against, and are handy for
+ * building streaming decoders from the same descriptor.
+ */
+template <class Protocol>
+struct IR_PulseDistanceWindows {
+	typedef IR_TickWindow<Protocol::header_mark_us,
+		Protocol::header_tolerance_us> HeaderMark;
+	typedef IR_TickWindow<Protocol::header_space_us,
+		Protocol::header_tolerance_us> HeaderSpace;
+	typedef IR_TickWindow<Protocol::bit_mark_us,
+		Protocol::bit_tolerance_us> BitMark;
+	typedef IR_TickWindow<Protocol::zero_space_us,
+		Protocol::bit_tolerance_us> ZeroSpace;
+	typedef IR_TickWindow<Protocol::one_space_us,
+		Protocol::bit_tolerance_us> OneSpace;
+	typedef IR_TickWindow<Protocol::trailer_mark_us,
+		Protocol::bit_tolerance_us> TrailerMark;
+
+	/* Only meaningful if Protocol::repeat_mark_us isn't 0 */
+	typedef IR_TickWindow<Protocol::repeat_mark_us,
+		Protocol::header_tolerance_us> RepeatMark;
+	typedef IR_TickWindow<Protocol::repeat_space_us,
+		Protocol::header_tolerance_us> RepeatSpace;
+
+	/* Segments in a complete frame: header, two per bit and the trailer.
+	 * The shortest possible frame if num_bits is 0.
+	 */
+	static const uint16_t frame_segments = 2 + (2 * Protocol::num_bits)
+		+ ((Protocol::trailer_mark_us != 0) ? 1 : 0);
+
+	/* Segments in a repeat frame: its header and one bit mark */
+	static const uint8_t repeat_segments = 3;
+};
+
+/**
+ * A protocol's num_bits, for the decoders that hand the payload back in 32
+ * bits. It's only defined for 1 to 32 bits, so using one of them with a
+ * longer or variable length protocol fails to compile instead of decoding
+ * garbage. Use decodeFramePulseDistanceLong() or decodeResultPulseDistance()
+ * for those.
+ */
+template <class Protocol, uint8_t fits = ((Protocol::num_bits >= 1)
+	&& (Protocol::num_bits <= 32))>
+struct IR_FixedNumBits;
+
+template <class Protocol>
+struct IR_FixedNumBits<Protocol, 1> {
+	static const uint8_t value = Protocol::num_bits;
+};
+
+/**
+ * irQuantizeTicks() at compile time, for building windows that compare
+ * against ir_qsegment_t durations.
+ */
+template <uint16_t ticks, uint8_t exponent = 1, uint8_t too_big = (ticks >= 32)>
+struct IR_QuantizeTicks {
+	static const uint8_t value =
+		IR_QuantizeTicks<(ticks >> 1), exponent + 1>::value;
+};
+
+template <uint16_t ticks, uint8_t exponent>
+struct IR_QuantizeTicks<ticks, exponent, 0> {
+	static const uint8_t value = (ticks < 16) ? (uint8_t)ticks :
+		(uint8_t)((exponent << 4) | (ticks & 0x0F));
+};
+
+/**
+ * An IR_TickWindow moved onto the ir_qsegment_t scale. Since quantizing
+ * rounds down and never reorders durations, it accepts everything Window
+ * does, plus at most one code's worth either side.
+ */
+template <class Window>
+struct IR_QuantizedWindow {
+	static const uint8_t lo = IR_QuantizeTicks<Window::lo>::value;
+	static const uint8_t hi = IR_QuantizeTicks<Window::hi>::value;
+
+	static inline uint8_t match(uint8_t code) {
+		return (code >= lo) && (code <= hi);
+	}
+};
+
+/**
+ * IR_PulseDistanceWindows for ir_qsegment_t durations.
+ */
+template <class Protocol>
+struct IR_QuantizedPulseDistanceWindows {
+	typedef IR_PulseDistanceWindows<Protocol> Ticks;
+
+	typedef IR_QuantizedWindow<typename Ticks::HeaderMark> HeaderMark;
+	typedef IR_QuantizedWindow<typename Ticks::HeaderSpace> HeaderSpace;
+	typedef IR_QuantizedWindow<typename Ticks::BitMark> BitMark;
+	typedef IR_QuantizedWindow<typename Ticks::ZeroSpace> ZeroSpace;
+	typedef IR_QuantizedWindow<typename Ticks::OneSpace> OneSpace;
+	typedef IR_QuantizedWindow<typename Ticks::TrailerMark> TrailerMark;
+	typedef IR_QuantizedWindow<typename Ticks::RepeatMark> RepeatMark;
+	typedef IR_QuantizedWindow<typename Ticks::RepeatSpace> RepeatSpace;
+
+	static const uint16_t frame_segments = Ticks::frame_segments;
+	static const uint8_t repeat_segments = Ticks::repeat_segments;
+};
+
+/**
+ * Picks the windows the buffered decoders compare a kind of segment against.
+ */
+template <class Protocol, class Segment>
+struct IR_SegmentWindows {
+	typedef IR_PulseDistanceWindows<Protocol> type;
+};
+
+template <class Protocol>
+struct IR_SegmentWindows<Protocol, ir_qsegment_t> {
+	typedef IR_QuantizedPulseDistanceWindows<Protocol> type;
+};
+
+/**
+ * A symbol threshold table for a pulse distance protocol descriptor. Each
+ * bound sits halfway between the segment lengths either side of it, so
+ * everything a decodeFramePulseDistance() window accepts lands on the same
+ * symbol, and then some:
+ *
+ *      IR_SYMBOL_SHORT: Bit marks, zero spaces and the trailer mark.
+ *      IR_SYMBOL_LONG: One spaces.
+ *      IR_SYMBOL_HEADER: The header mark and space and the repeat mark.
+ *
+ * The repeat space lands on whichever of these it's closest to, see
+ * repeat_space_symbol.
+ *
+ * There's only the one header class, so a 4.5ms and a 9ms header segment
+ * both come out as IR_SYMBOL_HEADER. decodeFrameSymbols() doesn't go by
+ * these symbols for the header; it checks the durations the symbol stream
+ * decoder keeps for it.
+ */
+template <class Protocol>
+struct IR_SymbolThresholds {
+	static const uint16_t short_us =
+		(Protocol::bit_mark_us > Protocol::zero_space_us)
+			? Protocol::bit_mark_us : Protocol::zero_space_us;
+	static const uint16_t header_min_us =
+		(Protocol::header_mark_us < Protocol::header_space_us)
+			? Protocol::header_mark_us : Protocol::header_space_us;
+	static const uint16_t header_max_us =
+		(Protocol::header_mark_us > Protocol::header_space_us)
+			? Protocol::header_mark_us : Protocol::header_space_us;
+
+	static const uint16_t short_min = IR_TickWindow<
+		(Protocol::bit_mark_us < Protocol::zero_space_us)
+			? Protocol::bit_mark_us : Protocol::zero_space_us,
+		Protocol::bit_tolerance_us>::lo;
+	static const uint16_t short_max = (uint16_t)IR_US_TO_TICKS(
+		((uint32_t)short_us + Protocol::one_space_us) / 2);
+	static const uint16_t long_max = (uint16_t)IR_US_TO_TICKS(
+		((uint32_t)Protocol::one_space_us + header_min_us) / 2);
+	static const uint16_t header_max = IR_TickWindow<
+		(Protocol::repeat_mark_us > header_max_us)
+			? Protocol::repeat_mark_us : header_max_us,
+		Protocol::header_tolerance_us>::hi;
+
+	/* What the second segment of a repeat frame classifies as */
+	static const uint8_t repeat_space_symbol =
+		(IR_US_TO_TICKS(Protocol::repeat_space_us) <= short_max)
+			? IR_SYMBOL_SHORT
+		: (IR_US_TO_TICKS(Protocol::repeat_space_us) <= long_max)
+			? IR_SYMBOL_LONG : IR_SYMBOL_HEADER;
+};
+
+/**
+ * An ir_symbol_thresholds_t initializer for a protocol descriptor.
+ *
+ * Example:
+ *
+ *  const ir_symbol_thresholds_t g_thresholds =
+ *      IR_SYMBOL_THRESHOLDS(IR_ProtocolSamsung);
+ */
+#define IR_SYMBOL_THRESHOLDS(Protocol) { \
+	IR_SymbolThresholds<Protocol>::short_min, \
+	IR_SymbolThresholds<Protocol>::short_max, \
+	IR_SymbolThresholds<Protocol>::long_max, \
+	IR_SymbolThresholds<Protocol>::header_max }
+
+/**
+ * Checks the parts of a buffered frame that decodeFramePulseDistance() checks
+ * before it looks at the bits: the length, the header and the trailer. Split
+ * out so that decoders that classify the bits some other way (several frames
+ * at a time, for example) accept exactly the same frames.
+ *
+ * Parameters:
+ *      segments: The recorded segments, starting with the header mark.
+ *          Either ir_segment_t or ir_qsegment_t.
+ *      count: The number of segments recorded.
+ *
+ * Return: IR_E_OK if the bits are worth decoding, otherwise the same errors
+ *      as decodeFramePulseDistance(), including IR_E_REPEAT.
+ */
+template <class Protocol, class Segment>
+int8_t checkFramePulseDistance(const Segment *segments, uint16_t count) {
+	typedef typename IR_SegmentWindows<Protocol, Segment>::type Windows;
+
+	/* A repeat frame is much shorter than a real one, so look for it before
+	 * deciding the frame is too short to be anything.
+	 */
+	if ((Protocol::repeat_mark_us != 0)
+			&& (count >= Windows::repeat_segments)
+			&& (count < Windows::frame_segments)
+			&& Windows::RepeatMark::match(segments[0].duration)
+			&& Windows::RepeatSpace::match(segments[1].duration)
+			&& Windows::BitMark::match(segments[2].duration)) {
+		return IR_E_REPEAT;
+	}
+
+	if (count < Windows::frame_segments) {
+		return IR_E_SHORT_FRAME;
+	}
+
+	if (!(Windows::HeaderMark::match(segments[0].duration)
+			&& Windows::HeaderSpace::match(segments[1].duration))) {
+		return IR_E_INVALID_START_OF_FRAME;
+	}
+
+	/* Where the trailer is in a variable length frame depends on count;
+	 * decodeFramePulseDistanceLong() checks it.
+	 */
+	if ((Protocol::trailer_mark_us != 0) && (Protocol::num_bits != 0)
+			&& !Windows::TrailerMark::match(
+				segments[Windows::frame_segments - 1].duration)) {
+		return IR_E_INVALID_END_OF_FRAME;
+	}
+
+	return IR_E_OK;
+}
+
+/**
+ * Decodes a buffered frame against a pulse distance protocol descriptor (see
+ * IR_ProtocolSamsung). Since the descriptor is a template argument, every
+ * window and loop bound is a constant and the compiler generates a loop for
+ * each protocol that is just as tight as a hand-written one.
+ *
+ * As with the original hand-written decoders, only the header, the trailer
+ * and whether each bit's space is a zero are checked. Anything that isn't a
+ * zero is taken to be a one.
+ *
+ * If the protocol has a repeat frame (see repeat_mark_us) and that's what
+ * was received, IR_E_REPEAT is returned and *data isn't touched, so if you
+ * keep passing the same variable it still holds the code being repeated.
+ *
+ * Parameters:
+ *      segments: The recorded segments, starting with the header mark.
+ *          Either ir_segment_t or ir_qsegment_t.
+ *      count: The number of segments recorded.
+ *      data: A pointer to a 32-bit location that will hold the decode result.
+ *
+ * Return:
+ *      IR_E_OK - If the decode is successful and *data is written.
+ *      IR_E_REPEAT - The frame was a repeat frame. *data isn't written.
+ *      IR_E_SHORT_FRAME - The frame wasn't long enough to make sense of.
+ *      IR_E_INVALID_START_OF_FRAME - The header doesn't match.
+ *      IR_E_INVALID_END_OF_FRAME - The trailer doesn't match.
+ */
+template <class Protocol, class Segment>
+int8_t decodeFramePulseDistance(const Segment *segments, uint8_t count,
+		uint32_t *data) {
+	typedef typename IR_SegmentWindows<Protocol, Segment>::type Windows;
+	uint32_t datagram = 0;
+	int8_t res;
+
+	res = checkFramePulseDistance<Protocol>(segments, count);
+	if (IR_E_OK != res) {
+		return res;
+	}
+
+	/* Every other segment starting at 3 is the space half of a bit */
+	for (uint8_t i = 3; i < 2 + (2 * IR_FixedNumBits<Protocol>::value);
+			i += 2) {
+		datagram <<= 1;
+		if (!Windows::ZeroSpace::match(segments[i].duration)) {
+			datagram |= 1;
+		}
+	}
+
+	*data = datagram;
+
+	return IR_E_OK;
+}
+
+/**
+ * Decodes a pulse distance frame of any length, such as the 100 to 300 bit
+ * frames air conditioner remotes send, into an array of bytes. The first bit
+ * received is the most significant bit of data[0], the ninth the most
+ * significant bit of data[1] and so on; unused bits of the last byte are 0.
+ *
+ * If Protocol::num_bits is 0, the frame is taken to be as long as it is:
+ * every mark and space pair between the header and the final (trailer) mark
+ * is a bit. Otherwise exactly num_bits are decoded, as with
+ * decodeFramePulseDistance(). Frames that long need a buffer of more than
+ * 255 segments; see IR_FixedBufferingStreamDecoder.
+ *
+ * Parameters:
+ *      segments: The recorded segments, starting with the header mark.
+ *          Either ir_segment_t or ir_qsegment_t.
+ *      count: The number of segments recorded.
+ *      data: Where to put the payload. Must hold (max_bits + 7) / 8 bytes.
+ *      max_bits: The most bits data can hold.
+ *      num_bits: Set to the number of bits decoded.
+ *
+ * Return: The same as decodeFramePulseDistance(), or IR_E_PAYLOAD_TOO_LONG
+ *      if there are more than max_bits bits. data and *num_bits are only
+ *      written when IR_E_OK is returned.
+ */
+template <class Protocol, class Segment>
+int8_t decodeFramePulseDistanceLong(const Segment *segments,
+		uint16_t count, uint8_t *data, uint16_t max_bits,
+		uint16_t *num_bits) {
+	typedef typename IR_SegmentWindows<Protocol, Segment>::type Windows;
+	uint16_t bits;
+	int8_t res;
+
+	res = checkFramePulseDistance<Protocol>(segments, count);
+	if (IR_E_OK != res) {
+		return res;
+	}
+
+	if (Protocol::num_bits != 0) {
+		bits = Protocol::num_bits;
+	} else if (Protocol::trailer_mark_us != 0) {
+		/* Header, a mark and space per bit, then the trailer */
+		bits = (count - 3) / 2;
+		if (!Windows::TrailerMark::match(segments[2 + (2 * bits)].duration)) {
+			return IR_E_INVALID_END_OF_FRAME;
+		}
+	} else {
+		bits = (count - 2) / 2;
+	}
+
+	if (bits > max_bits) {
+		return IR_E_PAYLOAD_TOO_LONG;
+	}
+
+	for (uint16_t i = 0; i < (bits + 7) / 8; i++) {
+		data[i] = 0;
+	}
+
+	/* Every other segment starting at 3 is the space half of a bit */
+	for (uint16_t i = 0; i < bits; i++) {
+		if (!Windows::ZeroSpace::match(segments[3 + (2 * i)].duration)) {
+			data[i >> 3] |= (uint8_t)(0x80 >> (i & 7));
+		}
+	}
+
+	*num_bits = bits;
+
+	return IR_E_OK;
+}
+
+extern uint32_t irDecodeSymbolBits(const uint8_t *symbols, uint8_t num_bits);
+
+/**
+ * decodeFramePulseDistance() for a packed symbol stream (see
+ * IR_SymbolStreamDecoder) classified against IR_SYMBOL_THRESHOLDS(Protocol).
+ * The header mark and space are checked against the protocol's windows, the
+ * same as decodeFramePulseDistance() does, since their symbols can't tell a
+ * Samsung header from an Apple one. After that it's just symbol compares:
+ * the trailer must be IR_SYMBOL_SHORT, and each bit is a 0 if its space is
+ * IR_SYMBOL_SHORT and a 1 otherwise. The bits are looked up two at a time
+ * rather than shifted in one at a time; see irDecodeSymbolBits().
+ *
+ * Frames decodeFramePulseDistance() accepts decode the same here. The bit
+ * marks and spaces aren't held to their windows, so some frames it rejects
+ * for a bad bit are accepted.
+ *
+ * Parameters:
+ *      symbols: The packed symbols, starting with the header mark.
+ *      count: The number of symbols recorded.
+ *      preamble: The header mark and space in ticks (see
+ *          IR_SymbolStreamDecoder::getPreamble()).
+ *      data: A pointer to a 32-bit location that will hold the decode result.
+ *
+ * Return: The same as decodeFramePulseDistance().
+ */
+template <class Protocol>
+int8_t decodeFrameSymbols(const uint8_t *symbols, uint16_t count,
+		const uint16_t *preamble, uint32_t *data) {
+	typedef IR_PulseDistanceWindows<Protocol> Windows;
+
+	if ((Protocol::repeat_mark_us != 0)
+			&& (count >= Windows::repeat_segments)
+			&& (count < Windows::frame_segments)
+			&& Windows::RepeatMark::match(preamble[0])
+			&& Windows::RepeatSpace::match(preamble[1])
+			&& (IR_SYMBOL_SHORT == irGetSymbol(symbols, 2))) {
+		return IR_E_REPEAT;
+	}
+
+	if (count < Windows::frame_segments) {
+		return IR_E_SHORT_FRAME;
+	}
+
+	if (!Windows::HeaderMark::match(preamble[0])
+			|| !Windows::HeaderSpace::match(preamble[1])) {
+		return IR_E_INVALID_START_OF_FRAME;
+	}
+
+	if ((Protocol::trailer_mark_us != 0)
+			&& (IR_SYMBOL_SHORT != irGetSymbol(symbols,
+				Windows::frame_segments - 1))) {
+		return IR_E_INVALID_END_OF_FRAME;
+	}
+
+	*data = irDecodeSymbolBits(symbols, IR_FixedNumBits<Protocol>::value);
+
+	return IR_E_OK;
+}
+
+/**
+ * How far a segment is from nominal, capped at the tolerance. Used for the
+ * quality of an ir_decode_result_t.
+ */
+inline uint16_t irSegmentDeviation(uint16_t ticks, uint16_t nominal,
+		uint16_t tolerance) {
+	uint16_t off = (ticks > nominal) ? ticks - nominal : nominal - ticks;
+
+	return (off > tolerance) ? tolerance : off;
+}
+
+/**
+ * Scores a frame that checkFramePulseDistance() found to be a repeat frame,
+ * for decodeResultPulseDistance().
+ *
+ * Return: IR_E_REPEAT
+ */
+template <class Protocol, class Segment>
+int8_t decodeResultRepeatPulseDistance(const Segment *segments,
+		ir_decode_result_t *result) {
+	/* At least a tick, so that the quality is never divided by 0 */
+	const uint16_t header_tolerance = (Protocol::header_tolerance_us == 0) ? 1
+		: (uint16_t)IR_US_TO_TICKS(Protocol::header_tolerance_us);
+	const uint16_t bit_tolerance = (Protocol::bit_tolerance_us == 0) ? 1
+		: (uint16_t)IR_US_TO_TICKS(Protocol::bit_tolerance_us);
+	uint32_t header_off;
+	uint32_t bit_off;
+
+	result->flags = IR_RESULT_F_REPEAT;
+	header_off = irSegmentDeviation(irSegmentTicks(&segments[0]),
+			(uint16_t)IR_US_TO_TICKS(Protocol::repeat_mark_us),
+			header_tolerance)
+		+ irSegmentDeviation(irSegmentTicks(&segments[1]),
+			(uint16_t)IR_US_TO_TICKS(Protocol::repeat_space_us),
+			header_tolerance);
+	bit_off = irSegmentDeviation(irSegmentTicks(&segments[2]),
+		(uint16_t)IR_US_TO_TICKS(Protocol::bit_mark_us), bit_tolerance);
+	result->quality = (uint8_t)(100 - (((header_off * 100)
+		/ header_tolerance) + ((bit_off * 100) / bit_tolerance)) / 3);
+
+	return IR_E_REPEAT;
+}
+
+/**
+ * The rest of decodeResultPulseDistance(), for a frame that
+ * checkFramePulseDistance() has passed as a complete frame.
+ */
+template <class Protocol, class Segment>
+int8_t decodeResultBodyPulseDistance(const Segment *segments, uint16_t count,
+		uint8_t protocol, ir_decode_result_t *result) {
+	typedef typename IR_SegmentWindows<Protocol, Segment>::type Windows;
+	const uint16_t header_tolerance = (Protocol::header_tolerance_us == 0) ? 1
+		: (uint16_t)IR_US_TO_TICKS(Protocol::header_tolerance_us);
+	const uint16_t bit_tolerance = (Protocol::bit_tolerance_us == 0) ? 1
+		: (uint16_t)IR_US_TO_TICKS(Protocol::bit_tolerance_us);
+	const uint16_t bit_mark = (uint16_t)IR_US_TO_TICKS(Protocol::bit_mark_us);
+	const uint16_t zero_space =
+		(uint16_t)IR_US_TO_TICKS(Protocol::zero_space_us);
+	const uint16_t one_space = (uint16_t)IR_US_TO_TICKS(Protocol::one_space_us);
+	uint32_t header_off;
+	uint32_t bit_off = 0;
+	uint16_t segments_scored;
+	uint16_t bits;
+	uint16_t ticks;
+	uint8_t one;
+
+	if (Protocol::num_bits != 0) {
+		bits = Protocol::num_bits;
+	} else if (Protocol::trailer_mark_us != 0) {
+		bits = (count - 3) / 2;
+		if (!Windows::TrailerMark::match(segments[2 + (2 * bits)].duration)) {
+			return IR_E_INVALID_END_OF_FRAME;
+		}
+	} else {
+		bits = (count - 2) / 2;
+	}
+
+	if (bits > (8 * IR_RESULT_PAYLOAD_BYTES)) {
+		return IR_E_PAYLOAD_TOO_LONG;
+	}
+
+	for (uint8_t i = 0; i < IR_RESULT_PAYLOAD_BYTES; i++) {
+		result->payload[i] = 0;
+	}
+
+	header_off = irSegmentDeviation(irSegmentTicks(&segments[0]),
+			(uint16_t)IR_US_TO_TICKS(Protocol::header_mark_us),
+			header_tolerance)
+		+ irSegmentDeviation(irSegmentTicks(&segments[1]),
+			(uint16_t)IR_US_TO_TICKS(Protocol::header_space_us),
+			header_tolerance);
+
+	/* Each bit is a mark and then a space that says whether it's a 1 */
+	for (uint16_t i = 0; i < bits; i++) {
+		one = !Windows::ZeroSpace::match(segments[3 + (2 * i)].duration);
+		if (0 != one) {
+			result->payload[i >> 3] |= (uint8_t)(0x80 >> (i & 7));
+		}
+
+		ticks = irSegmentTicks(&segments[3 + (2 * i)]);
+		bit_off += irSegmentDeviation(irSegmentTicks(&segments[2 + (2 * i)]),
+				bit_mark, bit_tolerance)
+			+ irSegmentDeviation(ticks, (0 != one) ? one_space : zero_space,
+				bit_tolerance);
+	}
+
+	segments_scored = 2 + (2 * bits);
+	if (Protocol::trailer_mark_us != 0) {
+		bit_off += irSegmentDeviation(irSegmentTicks(&segments[2 + (2 * bits)]),
+			(uint16_t)IR_US_TO_TICKS(Protocol::trailer_mark_us), bit_tolerance);
+		segments_scored++;
+	}
+
+	result->protocol = protocol;
+	result->num_bits = (uint8_t)bits;
+	if (32 == bits) {
+		result->address = ((uint16_t)result->payload[0] << 8)
+			| result->payload[1];
+		result->command = result->payload[2];
+	} else {
+		result->address = 0;
+		result->command = 0;
+	}
+	result->quality = (uint8_t)(100 - (((header_off * 100) / header_tolerance)
+		+ ((bit_off * 100) / bit_tolerance)) / segments_scored);
+
+	return IR_E_OK;
+}
+
+/**
+ * decodeFramePulseDistance() into an ir_decode_result_t. The frame is
+ * checked and its bits decoded exactly as decodeFramePulseDistanceLong()
+ * does, and in the same pass each segment's distance from nominal is added
+ * up for the quality score.
+ * From ir_qsegment_t the score is only as exact as the codes are.
+ *
+ * Parameters:
+ *      segments: The recorded segments, starting with the header mark.
+ *          Either ir_segment_t or ir_qsegment_t.
+ *      count: The number of segments recorded.
+ *      protocol: The id to put in result->protocol.
+ *      result: Filled in, see ir_decode_result_t. timestamp isn't touched.
+ *
+ * Return: The same as decodeFramePulseDistanceLong(). On errors, only
+ *      result->flags and result->quality are written.
+ */
+template <class Protocol, class Segment>
+int8_t decodeResultPulseDistance(const Segment *segments, uint16_t count,
+		uint8_t protocol, ir_decode_result_t *result) {
+	int8_t res;
+
+	result->flags = 0;
+	result->quality = 0;
+
+	res = checkFramePulseDistance<Protocol>(segments, count);
+	if (IR_E_REPEAT == res) {
+		return decodeResultRepeatPulseDistance<Protocol>(segments, result);
+	} else if (IR_E_OK != res) {
+		return res;
+	}
+
+	return decodeResultBodyPulseDistance<Protocol>(segments, count, protocol,
+		result);
+}
+
+/**
+ * decodeFramePulseDistance() for a frame view (see ir_frame_view_t).
+ */
+template <class Protocol>
+int8_t decodeFramePulseDistance(const ir_frame_view_t *frame,
+		uint32_t *data) {
+	return decodeFramePulseDistance<Protocol>(frame->segments, frame->count,
+		data);
+}
+
+/**
+ * Results a IR_StreamMachine hands back for every segment it is given.
+ */
+#define IR_MACHINE_BUSY         0
+#define IR_MACHINE_REJECT       1
+#define IR_MACHINE_ACCEPT       2
+#define IR_MACHINE_REPEAT       3
+
+/**
+ * A streaming decoder for one protocol that can be driven by an
+ * IR_StreamDispatcher. Unlike an IR_StreamDecoder, it doesn't need to worry
+ * about the first edge of a frame or when a frame ends; it is just reset()
+ * before every frame and then handed each segment in turn until it either
+ * rejects the frame or accepts it. A machine that recognises a repeat frame
+ * returns IR_MACHINE_REPEAT instead of accepting; its getData() is then
+ * meaningless, since the frame carries no data.
+ */
+class IR_StreamMachine {
+public:
+	virtual void reset(void) = 0;
+	virtual uint8_t segmentEvent(uint16_t duration) = 0;
+	virtual uint32_t getData(void) = 0;
+};
+
+/**
+ * IR_StreamMachine for any pulse distance protocol descriptor (see
+ * IR_ProtocolSamsung). It keeps just the payload and a segment counter, so
+ * each protocol you add costs a handful of bytes of RAM.
+ *
+ * Unlike decodeFramePulseDistance(), every bit mark is checked as well,
+ * since the machine has to decide as early as possible whether it is still
+ * in the running.
+ *
+ * Repeat frames are reported with IR_MACHINE_REPEAT as soon as their bit
+ * mark ends, which is only the fourth edge of the frame.
+ */
+template <class Protocol>
+class IR_PulseDistanceStreamMachine : public IR_StreamMachine {
+private:
+	typedef IR_PulseDistanceWindows<Protocol> Windows;
+
+	/* What the segments so far could be the start of */
+	enum {
+		START_FRAME = 0x01,
+		START_REPEAT = 0x02
+	};
+
+	uint32_t _data;
+	uint8_t _segment;
+	uint8_t _start;
+
+public:
+	IR_PulseDistanceStreamMachine(void) {
+		reset();
+	}
+
+	void reset(void) {
+		_data = 0;
+		_segment = 0;
+		_start = 0;
+	}
+
+	uint8_t segmentEvent(uint16_t duration) {
+		uint8_t segment = _segment++;
+
+		/* The header mark of a frame and a repeat frame can be the same
+		 * length, so keep both possibilities open until the space.
+		 */
+		if (0 == segment) {
+			if (Windows::HeaderMark::match(duration)) {
+				_start |= START_FRAME;
+			}
+			if ((Protocol::repeat_mark_us != 0)
+					&& Windows::RepeatMark::match(duration)) {
+				_start |= START_REPEAT;
+			}
+			return (0 != _start) ? IR_MACHINE_BUSY : IR_MACHINE_REJECT;
+		}
+
+		if (1 == segment) {
+			if ((0 != (_start & START_FRAME))
+					&& Windows::HeaderSpace::match(duration)) {
+				_start = START_FRAME;
+				return IR_MACHINE_BUSY;
+			}
+			if ((0 != (_start & START_REPEAT))
+					&& Windows::RepeatSpace::match(duration)) {
+				_start = START_REPEAT;
+				return IR_MACHINE_BUSY;
+			}
+			return IR_MACHINE_REJECT;
+		}
+
+		if (START_REPEAT == _start) {
+			return Windows::BitMark::match(duration) ?
+				IR_MACHINE_REPEAT : IR_MACHINE_REJECT;
+		}
+
+		if (segment < 2 + (2 * IR_FixedNumBits<Protocol>::value)) {
+			if (0 == (segment & 1)) {
+				return Windows::BitMark::match(duration) ?
+					IR_MACHINE_BUSY : IR_MACHINE_REJECT;
+			}
+
+			_data <<= 1;
+			if (!Windows::ZeroSpace::match(duration)) {
+				_data |= 1;
+			}
+
+			if ((Protocol::trailer_mark_us == 0)
+					&& (segment
+						== 1 + (2 * IR_FixedNumBits<Protocol>::value))) {
+				return IR_MACHINE_ACCEPT;
+			}
+			return IR_MACHINE_BUSY;
+		}
+
+		return Windows::TrailerMark::match(duration) ?
+			IR_MACHINE_ACCEPT : IR_MACHINE_REJECT;
+	}
+
+	uint32_t getData(void) {
+		return _data;
+	}
+};
+
+/* Most machines an IR_StreamDispatcher can run at once */
+#define IR_MAX_STREAM_MACHINES          8
+
+/**
+ * Decoder delegate that fans every segment out to several IR_StreamMachine
+ * objects at once, so you get multi-protocol decoding without a frame
+ * buffer. A machine that rejects the frame is dropped for the rest of it,
+ * so later edges only cost time for the protocols that are still live.
+ *
+ * The first machine to accept the frame wins and the rest are stopped. If
+ * two protocols could both accept the same frame, the one listed first in
+ * setMachines() takes priority. The frame is made available right away,
+ * without waiting for the end-of-frame timeout.
+ *
+ * Repeat frames are made available as soon as a machine recognises one, as
+ * a repeat of the last frame that was accepted: isRepeatFrame() is set and
+ * getMatchedMachine() and getData() report that frame again. A repeat frame
+ * before any frame has been accepted counts as unmatched.
+ *
+ * It runs at most IR_MAX_STREAM_MACHINES machines.
+ */
+class IR_StreamDispatcher : public IR_StreamDecoder {
+private:
+	IR_StreamMachine **_machines;
+	uint8_t _num_machines;
+
+	/* Indexes into _machines of the machines still live in this frame, in
+	 * the order they were given to setMachines()
+	 */
+	uint8_t _live[IR_MAX_STREAM_MACHINES];
+	uint8_t _num_live;
+	IR_StreamMachine *_matched;
+	uint8_t _first_edge;
+	uint8_t _frame_available;
+	uint8_t _unmatched_frames;
+
+	/* The last frame accepted, for repeat frames to refer back to */
+	IR_StreamMachine *_last_matched;
+	uint32_t _data;
+	uint8_t _repeat;
+
+public:
+	IR_StreamDispatcher(void);
+	void edgeEvent(uint16_t duration);
+	void endOfFrameEvent(void);
+
+	void setMachines(IR_StreamMachine **machines, uint8_t num_machines);
+	void readyForNextFrame(void);
+	uint8_t isFrameAvailable(void);
+	IR_StreamMachine *getMatchedMachine(void);
+	uint32_t getData(void);
+	uint8_t isRepeatFrame(void);
+	uint8_t getUnmatchedFrameCount(void);
+};
+
+extern int8_t decodeFrameAny(const ir_segment_t *segments, uint8_t count,
+		ir_decode_result_t *result, uint32_t timestamp = 0);
+extern int8_t decodeFrameAny(IR_BufferingStreamDecoder *bufferedDecoder,
+		ir_decode_result_t *result, uint32_t timestamp = 0);
+extern int8_t decodeFrameAny(IR_QueuedBufferingStreamDecoder *queuedDecoder,
+		ir_decode_result_t *result, uint32_t timestamp = 0);
+extern int8_t decodeFrameAny(const ir_frame_view_t *frame,
+		ir_decode_result_t *result, uint32_t timestamp = 0);
 extern int8_t decodeFrameApple(
 		IR_BufferingStreamDecoder *bufferedDecoder, 
 		uint32_t *data);
+extern int8_t decodeFrameApple(
+		IR_QueuedBufferingStreamDecoder *queuedDecoder,
+		uint32_t *data);
+extern int8_t decodeFrameApple(const ir_frame_view_t *frame,
+		uint32_t *data);
 extern int8_t decodeFrameSamsung(
 		IR_BufferingStreamDecoder *bufferedDecoder, 
 		uint32_t *data);
+extern int8_t decodeFrameSamsung(
+		IR_QueuedBufferingStreamDecoder *queuedDecoder,
+		uint32_t *data);
+extern int8_t decodeFrameSamsung(const ir_frame_view_t *frame,
+		uint32_t *data);
 
 extern IR_HwInterface IR_InputCaptureInterface;
 
+#if !defined(ARDUINO)
+/* Host backend only. See BTHI_IR_Hal_Host.cpp. */
+extern void irHostEdge(uint32_t now, uint16_t isr_latency = 0);
+extern void irHostIdle(uint32_t now);
+extern uint32_t irHostReplay(uint32_t start, const ir_segment_t *segments,
+		uint16_t count, uint8_t real_time);
+extern void irHostCaptureVector(void);
+extern void irHostOverflowVector(void);
+#endif
+
+#include <BTHI_IR_Hal.h>
+
+/**
+ * The narrowest unsigned type that can count up to N segments: uint8_t up to
+ * 255, uint16_t beyond. On the AVR every extra byte of index is extra
+ * instructions in the ISR.
+ */
+template <uint16_t N, uint8_t fits_in_byte = (N <= 0xFF)>
+struct IR_SegmentIndex {
+	typedef uint16_t type;
+};
+
+template <uint16_t N>
+struct IR_SegmentIndex<N, 1> {
+	typedef uint8_t type;
+};
+
+/**
+ * IR_BufferingStreamDecoder with its segment buffer built in. N is fixed at
+ * compile time, so there's no setSegmentBuffer() to call, the buffer bounds
+ * check is against a constant, counts use the narrowest type that holds N
+ * (see IR_SegmentIndex) and the segments are reached directly rather than
+ * through a pointer. Paired with IR_StaticHwInterface, the whole edge path
+ * is inlined into the ISR with no indirection at all.
+ *
+ * Example:
+ *
+ *  IR_FixedBufferingStreamDecoder<72> decoder;
+ *  IR_StaticHwInterface<IR_FixedBufferingStreamDecoder<72> > hw;
+ *  IR_STATIC_HW_INTERFACE_ISRS(hw)
+ *
+ * It's also how to receive frames of more than 255 segments, which
+ * IR_BufferingStreamDecoder can't hold: the index only widens to 16 bits for
+ * the instantiations that need it, so sketches with small buffers don't pay
+ * for it. See decodeFramePulseDistanceLong() for decoding them.
+ *
+ * Make Segment ir_qsegment_t to store durations in half the RAM (see
+ * irQuantizeTicks()).
+ *
+ * Otherwise it behaves exactly like IR_BufferingStreamDecoder; see there for
+ * what each method does.
+ */
+template <uint16_t N, class Segment = ir_segment_t>
+class IR_FixedBufferingStreamDecoder : public IR_StreamDecoder {
+public:
+	typedef typename IR_SegmentIndex<N>::type index_t;
+
+private:
+	Segment _segments[N];
+	index_t _count;
+	index_t _frame_segments;
+	uint8_t _segment_overflows;
+	uint8_t _first_edge;
+
+	/* Polled by loop() while the ISR sets it */
+	volatile uint8_t _frame_complete;
+
+public:
+	IR_FixedBufferingStreamDecoder(void) {
+		_count = 0;
+		_frame_segments = 0;
+		_segment_overflows = 0;
+		_first_edge = 1;
+		_frame_complete = 0;
+	}
+
+	void edgeEvent(uint16_t duration) {
+		if (0 != _frame_complete) {
+			return;
+		}
+
+		if (0 != _first_edge) {
+			_first_edge = 0;
+			return;
+		}
+
+		if (_count >= N) {
+			if (_segment_overflows < (uint8_t)0xFF) {
+				_segment_overflows++;
+			}
+			return;
+		}
+
+		irStoreSegment(&_segments[_count++], duration);
+
+		if (_count == _frame_segments) {
+			_frame_complete = 1;
+		}
+	}
+
+	void endOfFrameEvent(void) {
+		if (_count > 0) {
+			_frame_complete = 1;
+		}
+	}
+
+	void setFrameLength(index_t num_segments) {
+		IR_HAL_DISABLE_INTERRUPTS();
+		_frame_segments = num_segments;
+		IR_HAL_ENABLE_INTERRUPTS();
+	}
+
+	void readyForNextFrame(void) {
+		IR_HAL_DISABLE_INTERRUPTS();
+		_count = 0;
+		_segment_overflows = 0;
+		_first_edge = 1;
+		_frame_complete = 0;
+		IR_HAL_ENABLE_INTERRUPTS();
+	}
+
+	Segment *getSegmentBuffer(void) {
+		return _segments;
+	}
+
+	index_t getCapacity(void) {
+		return N;
+	}
+
+	uint8_t isFrameAvailable(void) {
+		return _frame_complete;
+	}
+
+	index_t getSegmentCount(void) {
+		return (0 == _frame_complete) ? 0 : _count;
+	}
+
+	uint8_t getSegmentOverflowCount(void) {
+		return _segment_overflows;
+	}
+};
+
+/**
+ * decodeFramePulseDistance(), decodeFramePulseDistanceLong(),
+ * decodeFrameSamsung() and decodeFrameApple() for a fixed-size buffering
+ * decoder. Only the start of a frame matters to the 32-bit decoders, so a
+ * frame longer than 255 segments is decoded by them as if the buffer had
+ * been 255 segments long, the same as IR_BufferingStreamDecoder would.
+ */
+template <class Protocol, uint16_t N, class Segment>
+int8_t decodeFramePulseDistance(
+		IR_FixedBufferingStreamDecoder<N, Segment> *decoder, uint32_t *data) {
+	typename IR_FixedBufferingStreamDecoder<N, Segment>::index_t count =
+		decoder->getSegmentCount();
+
+	return decodeFramePulseDistance<Protocol>(decoder->getSegmentBuffer(),
+		(count > 0xFF) ? (uint8_t)0xFF : (uint8_t)count, data);
+}
+
+template <class Protocol, uint16_t N, class Segment>
+int8_t decodeFramePulseDistanceLong(
+		IR_FixedBufferingStreamDecoder<N, Segment> *decoder, uint8_t *data,
+		uint16_t max_bits, uint16_t *num_bits) {
+	return decodeFramePulseDistanceLong<Protocol>(decoder->getSegmentBuffer(),
+		decoder->getSegmentCount(), data, max_bits, num_bits);
+}
+
+template <uint16_t N, class Segment>
+int8_t decodeFrameSamsung(IR_FixedBufferingStreamDecoder<N, Segment> *decoder,
+		uint32_t *data) {
+	return decodeFramePulseDistance<IR_ProtocolSamsung>(decoder, data);
+}
+
+template <uint16_t N, class Segment>
+int8_t decodeFrameApple(IR_FixedBufferingStreamDecoder<N, Segment> *decoder,
+		uint32_t *data) {
+	return decodeFramePulseDistance<IR_ProtocolApple>(decoder, data);
+}
+
+/**
+ * The free slot mask of an IR_PooledBufferingStreamDecoder with every slot
+ * free. It's a byte, so it's only defined for 1 to 8 slots and any other
+ * pool size fails to compile.
+ */
+template <uint8_t Slots, uint8_t fits = ((Slots >= 1) && (Slots <= 8))>
+struct IR_PoolSlotMask;
+
+template <uint8_t Slots>
+struct IR_PoolSlotMask<Slots, 1> {
+	static const uint8_t all = (uint8_t)((1U << Slots) - 1);
+};
+
+/**
+ * Buffering decoder that captures into a fixed pool of Slots frame buffers
+ * of SegmentsPerSlot segments each, and lends you frames as ir_frame_view_t.
+ * A frame stays yours, untouched, until you hand it back with returnFrame(),
+ * and capture carries on into whichever slots are free in the meantime. So
+ * you can hold on to a frame for as long as you like, pass the same view to
+ * a decoder and then a logger, and return frames in any order.
+ *
+ * Example:
+ *
+ *  IR_PooledBufferingStreamDecoder<3, 72> decoder;
+ *  ir_frame_view_t frame;
+ *
+ *  if (decoder.borrowFrame(&frame)) {
+ *      res = decodeFrameSamsung(&frame, &data);
+ *      ...
+ *      decoder.returnFrame(&frame);
+ *  }
+ *
+ * Frames are borrowed oldest first. A frame that starts when every slot is
+ * either waiting to be borrowed or borrowed is dropped as a whole and counted
+ * (see getDroppedFrameCount()). Slots can be 1 to 8.
+ */
+template <uint8_t Slots, uint8_t SegmentsPerSlot>
+class IR_PooledBufferingStreamDecoder : public IR_StreamDecoder {
+private:
+	ir_segment_t _segments[Slots][SegmentsPerSlot];
+	ir_frame_info_t _frames[Slots];
+
+	/* One bit per slot that capture may use. Taken by the ISR, given back
+	 * by returnFrame() with interrupts disabled.
+	 */
+	volatile uint8_t _free_slots;
+
+	/* Complete frames in the order they arrived, waiting to be borrowed.
+	 * _head and _tail are free-running counts, each written by one side;
+	 * _in and _out are where they point in _ready.
+	 */
+	uint8_t _ready[Slots];
+	volatile uint8_t _head;
+	volatile uint8_t _tail;
+	uint8_t _in;
+	uint8_t _out;
+	volatile uint8_t _dropped_frames;
+
+	/* Capture (ISR) state */
+	uint8_t _write_slot;
+	uint8_t _count;
+	uint8_t _segment_overflows;
+	uint8_t _first_edge;
+	uint8_t _dropping;
+	uint8_t _published;
+	uint8_t _frame_segments;
+
+	void publishFrame(void) {
+		_frames[_write_slot].count = _count;
+		_frames[_write_slot].segment_overflows = _segment_overflows;
+		_ready[_in] = _write_slot;
+		if (++_in >= Slots) {
+			_in = 0;
+		}
+
+		/* The slot must be completely written before it's published */
+		IR_MEMORY_BARRIER();
+		_head = _head + 1;
+	}
+
+public:
+	IR_PooledBufferingStreamDecoder(void) {
+		_free_slots = IR_PoolSlotMask<Slots>::all;
+		_head = 0;
+		_tail = 0;
+		_in = 0;
+		_out = 0;
+		_dropped_frames = 0;
+		_write_slot = 0;
+		_count = 0;
+		_segment_overflows = 0;
+		_first_edge = 1;
+		_dropping = 0;
+		_published = 0;
+		_frame_segments = 0;
+	}
+
+	void edgeEvent(uint16_t duration) {
+		if (0 != _first_edge) {
+			_first_edge = 0;
+			_count = 0;
+			_segment_overflows = 0;
+
+			/* Claim a free slot for the whole frame, or drop it */
+			_dropping = 1;
+			for (uint8_t slot = 0; slot < Slots; slot++) {
+				if (0 != (_free_slots & (1 << slot))) {
+					_free_slots = _free_slots & (uint8_t)~(1 << slot);
+					_write_slot = slot;
+					_dropping = 0;
+					break;
+				}
+			}
+			return;
+		}
+
+		if (0 != _dropping) {
+			/* Just remember that this was a real frame */
+			_count = 1;
+			return;
+		}
+
+		if (0 != _published) {
+			/* Already lent early; wait for the real end of frame */
+			return;
+		}
+
+		if (_count >= SegmentsPerSlot) {
+			if (_segment_overflows < (uint8_t)0xFF) {
+				_segment_overflows++;
+			}
+			return;
+		}
+
+		irStoreSegment(&_segments[_write_slot][_count++], duration);
+
+		/* See IR_BufferingStreamDecoder::setFrameLength() */
+		if (_count == _frame_segments) {
+			publishFrame();
+			_published = 1;
+		}
+	}
+
+	void endOfFrameEvent(void) {
+		if (0 == _first_edge) {
+			if (0 != _dropping) {
+				if ((_count > 0) && (_dropped_frames < (uint8_t)0xFF)) {
+					_dropped_frames++;
+				}
+			} else if (0 == _published) {
+				if (_count > 0) {
+					publishFrame();
+				} else {
+					/* Nothing was recorded; the slot is still free */
+					_free_slots = _free_slots | (uint8_t)(1 << _write_slot);
+				}
+			}
+		}
+
+		_first_edge = 1;
+		_published = 0;
+	}
+
+	void setFrameLength(uint8_t num_segments) {
+		IR_HAL_DISABLE_INTERRUPTS();
+		_frame_segments = num_segments;
+		IR_HAL_ENABLE_INTERRUPTS();
+	}
+
+	/**
+	 * Lends you the oldest complete frame. Only call this from one place
+	 * (your loop(), say); it doesn't disable interrupts.
+	 *
+	 * Parameters:
+	 *      frame: Filled in with the frame if there is one.
+	 *
+	 * Return: 1 if frame was filled in, 0 if no frame is waiting.
+	 */
+	uint8_t borrowFrame(ir_frame_view_t *frame) {
+		uint8_t slot;
+
+		if (_head == _tail) {
+			return 0;
+		}
+
+		/* Don't read the slot before seeing that it was published */
+		IR_MEMORY_BARRIER();
+		slot = _ready[_out];
+		if (++_out >= Slots) {
+			_out = 0;
+		}
+
+		frame->segments = _segments[slot];
+		frame->count = _frames[slot].count;
+		frame->segment_overflows = _frames[slot].segment_overflows;
+		frame->slot = slot;
+
+		IR_MEMORY_BARRIER();
+		_tail = _tail + 1;
+
+		return 1;
+	}
+
+	/**
+	 * Hands a borrowed frame's slot back for capture. The view is emptied,
+	 * so a second return of the same view does nothing.
+	 *
+	 * Parameters:
+	 *      frame: A view filled in by borrowFrame().
+	 *
+	 * Return: Nothing
+	 */
+	void returnFrame(ir_frame_view_t *frame) {
+		if ((NULL == frame->segments) || (frame->slot >= Slots)) {
+			return;
+		}
+
+		IR_HAL_DISABLE_INTERRUPTS();
+		_free_slots = _free_slots | (uint8_t)(1 << frame->slot);
+		IR_HAL_ENABLE_INTERRUPTS();
+
+		frame->segments = NULL;
+		frame->count = 0;
+	}
+
+	uint8_t isFrameAvailable(void) {
+		return (_head != _tail) ? 1 : 0;
+	}
+
+	/* Frames waiting to be borrowed */
+	uint8_t getAvailableFrameCount(void) {
+		return (uint8_t)(_head - _tail);
+	}
+
+	/* Slots that are neither waiting to be borrowed nor borrowed */
+	uint8_t getFreeSlotCount(void) {
+		uint8_t free_slots = _free_slots;
+		uint8_t count = 0;
+
+		for (uint8_t slot = 0; slot < Slots; slot++) {
+			if (0 != (free_slots & (1 << slot))) {
+				count++;
+			}
+		}
+		return count;
+	}
+
+	uint8_t getDroppedFrameCount(void) {
+		return _dropped_frames;
+	}
+};
+
+/**
+ * Buffering decoder that classifies each segment against a threshold table
+ * as it arrives (see irClassifyTicks()) and stores the 2-bit symbol instead
+ * of the duration. A 67 segment Samsung frame takes 17 bytes instead of 134,
+ * and decoding it is symbol compares rather than range checks; see
+ * decodeFrameSymbols().
+ *
+ * The durations are gone once classified, so this is no use for working out
+ * an unknown protocol. Use IR_BufferingStreamDecoder for that. The header
+ * mark and space are the exception: they're kept as well (4 more bytes), see
+ * getPreamble().
+ *
+ * Example:
+ *
+ *  const ir_symbol_thresholds_t g_thresholds =
+ *      IR_SYMBOL_THRESHOLDS(IR_ProtocolSamsung);
+ *  IR_SymbolStreamDecoder<72> decoder(&g_thresholds);
+ *
+ * Otherwise it behaves like IR_FixedBufferingStreamDecoder.
+ */
+template <uint16_t N>
+class IR_SymbolStreamDecoder : public IR_StreamDecoder {
+public:
+	typedef typename IR_SegmentIndex<N>::type index_t;
+
+private:
+	uint8_t _symbols[IR_SYMBOL_BYTES(N)];
+	uint16_t _preamble[2];
+	const ir_symbol_thresholds_t *_thresholds;
+	index_t _count;
+	index_t _frame_segments;
+	uint8_t _segment_overflows;
+	uint8_t _first_edge;
+
+	/* Polled by loop() while the ISR sets it */
+	volatile uint8_t _frame_complete;
+
+public:
+	IR_SymbolStreamDecoder(const ir_symbol_thresholds_t *thresholds) {
+		_thresholds = thresholds;
+		_count = 0;
+		_frame_segments = 0;
+		_segment_overflows = 0;
+		_first_edge = 1;
+		_frame_complete = 0;
+	}
+
+	void edgeEvent(uint16_t duration) {
+		uint8_t symbol;
+
+		if (0 != _frame_complete) {
+			return;
+		}
+
+		if (0 != _first_edge) {
+			_first_edge = 0;
+			return;
+		}
+
+		if (_count >= N) {
+			if (_segment_overflows < (uint8_t)0xFF) {
+				_segment_overflows++;
+			}
+			return;
+		}
+
+		if (_count < 2) {
+			_preamble[_count] = duration;
+		}
+
+		symbol = irClassifyTicks(_thresholds, duration);
+
+		/* The first symbol of a byte clears whatever the last frame left */
+		if (0 == (_count & 3)) {
+			_symbols[_count >> 2] = symbol;
+		} else {
+			_symbols[_count >> 2] |= (uint8_t)(symbol << ((_count & 3) << 1));
+		}
+		_count++;
+
+		if (_count == _frame_segments) {
+			_frame_complete = 1;
+		}
+	}
+
+	void endOfFrameEvent(void) {
+		if (_count > 0) {
+			_frame_complete = 1;
+		}
+	}
+
+	void setThresholds(const ir_symbol_thresholds_t *thresholds) {
+		IR_HAL_DISABLE_INTERRUPTS();
+		_thresholds = thresholds;
+		IR_HAL_ENABLE_INTERRUPTS();
+	}
+
+	void setFrameLength(index_t num_segments) {
+		IR_HAL_DISABLE_INTERRUPTS();
+		_frame_segments = num_segments;
+		IR_HAL_ENABLE_INTERRUPTS();
+	}
+
+	void readyForNextFrame(void) {
+		IR_HAL_DISABLE_INTERRUPTS();
+		_count = 0;
+		_segment_overflows = 0;
+		_first_edge = 1;
+		_frame_complete = 0;
+		IR_HAL_ENABLE_INTERRUPTS();
+	}
+
+	const uint8_t *getSymbolBuffer(void) {
+		return _symbols;
+	}
+
+	/* The header mark and space in ticks, as they were before classifying */
+	const uint16_t *getPreamble(void) {
+		return _preamble;
+	}
+
+	uint8_t getSymbol(index_t index) {
+		return irGetSymbol(_symbols, index);
+	}
+
+	uint8_t isFrameAvailable(void) {
+		return _frame_complete;
+	}
+
+	index_t getSymbolCount(void) {
+		return (0 == _frame_complete) ? 0 : _count;
+	}
+
+	uint8_t getSegmentOverflowCount(void) {
+		return _segment_overflows;
+	}
+};
+
+/**
+ * decodeFramePulseDistance(), decodeFrameSamsung() and decodeFrameApple()
+ * for a symbol stream decoder. Its thresholds must suit the protocol's bits.
+ * The header is checked against the protocol's own windows, so a Samsung
+ * frame doesn't decode as Apple or the other way round; see
+ * decodeFrameSymbols().
+ */
+template <class Protocol, uint16_t N>
+int8_t decodeFramePulseDistance(IR_SymbolStreamDecoder<N> *decoder,
+		uint32_t *data) {
+	return decodeFrameSymbols<Protocol>(decoder->getSymbolBuffer(),
+		decoder->getSymbolCount(), decoder->getPreamble(), data);
+}
+
+template <uint16_t N>
+int8_t decodeFrameSamsung(IR_SymbolStreamDecoder<N> *decoder,
+		uint32_t *data) {
+	return decodeFramePulseDistance<IR_ProtocolSamsung>(decoder, data);
+}
+
+template <uint16_t N>
+int8_t decodeFrameApple(IR_SymbolStreamDecoder<N> *decoder,
+		uint32_t *data) {
+	return decodeFramePulseDistance<IR_ProtocolApple>(decoder, data);
+}
+
+/**
+ * Which bucket of a preamble index (see IR_PreambleDispatcher) a header
+ * segment falls in. Buckets are a quarter of an octave wide, i.e. four
+ * irQuantizeTicks() codes, so a header window of +/-10% or so touches two
+ * or three of them.
+ */
+#define IR_PREAMBLE_BUCKETS             52
+
+inline uint8_t irPreambleBucket(uint16_t ticks) {
+	return irQuantizeTicks(ticks) >> 2;
+}
+
+/* A decodeResultPulseDistance() style decoder, as IR_PreambleDispatcher
+ * calls it.
+ */
+typedef int8_t (*ir_result_decoder_t)(const ir_segment_t *segments,
+		uint16_t count, uint8_t protocol, ir_decode_result_t *result);
+
+/**
+ * The narrowest unsigned type with a bit for each of N decoders.
+ */
+template <uint8_t N, uint8_t size = (N <= 8) ? 1 : ((N <= 16) ? 2 : 4)>
+struct IR_PreambleMask {
+	typedef uint32_t type;
+};
+
+template <uint8_t N>
+struct IR_PreambleMask<N, 1> {
+	typedef uint8_t type;
+};
+
+template <uint8_t N>
+struct IR_PreambleMask<N, 2> {
+	typedef uint16_t type;
+};
+
+/**
+ * Picks the decoder for a buffered frame by its preamble, instead of trying
+ * every protocol in turn the way decodeFrameAny() does. Each registered
+ * decoder sets its bit in the buckets (see irPreambleBucket()) its header
+ * mark and header space windows cover, one table for marks and one for
+ * spaces. A frame's candidates are then the bits set in both its mark's and
+ * its space's bucket: two table reads, however many decoders there are.
+ * Only those candidates are run, lowest slot first, until one decodes the
+ * frame. If none does, the first candidate's error is returned.
+ *
+ * Example:
+ *
+ *  IR_PreambleDispatcher<8> dispatcher;
+ *
+ *  dispatcher.addPulseDistance<IR_ProtocolSamsung>(IR_PROTOCOL_SAMSUNG);
+ *  dispatcher.addPulseDistance<IR_ProtocolApple>(IR_PROTOCOL_APPLE);
+ *  ...
+ *  if (decoder.isFrameAvailable()) {
+ *      res = dispatcher.decode(&decoder, &result, millis());
+ *      ...
+ *  }
+ *
+ * MaxDecoders can be 1 to 32. The tables are 2 * IR_PREAMBLE_BUCKETS
+ * masks of 1, 2 or 4 bytes (up to 8, 16 or 32 decoders), and each decoder
+ * takes a pointer and a byte more: 129 bytes for 8 decoders on the AVR.
+ * Frames must be of ir_segment_t; decodeFrameAny() also takes quantized
+ * ones.
+ */
+template <uint8_t MaxDecoders>
+class IR_PreambleDispatcher {
+public:
+	typedef typename IR_PreambleMask<MaxDecoders>::type mask_t;
+
+private:
+	mask_t _mark_buckets[IR_PREAMBLE_BUCKETS];
+	mask_t _space_buckets[IR_PREAMBLE_BUCKETS];
+	ir_result_decoder_t _decoders[MaxDecoders];
+	uint8_t _protocols[MaxDecoders];
+	uint8_t _num_decoders;
+
+	static void indexWindow(mask_t *buckets, uint8_t slot, uint16_t min,
+			uint16_t max) {
+		uint8_t last = irPreambleBucket(max);
+
+		for (uint8_t b = irPreambleBucket(min); b <= last; b++) {
+			buckets[b] |= (mask_t)((mask_t)1 << slot);
+		}
+	}
+
+public:
+	IR_PreambleDispatcher(void) {
+		clear();
+	}
+
+	/* Forgets every decoder */
+	void clear(void) {
+		for (uint8_t b = 0; b < IR_PREAMBLE_BUCKETS; b++) {
+			_mark_buckets[b] = 0;
+			_space_buckets[b] = 0;
+		}
+		_num_decoders = 0;
+	}
+
+	/**
+	 * Registers a decoder. It isn't run for any frame until addPreamble()
+	 * says which preambles it accepts.
+	 *
+	 * Parameters:
+	 *      decoder: Called with the frame and protocol.
+	 *      protocol: The id to pass it, for result->protocol.
+	 *
+	 * Return: The decoder's slot, or -1 if MaxDecoders are registered.
+	 */
+	int8_t addDecoder(ir_result_decoder_t decoder, uint8_t protocol) {
+		if (_num_decoders >= MaxDecoders) {
+			return -1;
+		}
+
+		_decoders[_num_decoders] = decoder;
+		_protocols[_num_decoders] = protocol;
+		return (int8_t)_num_decoders++;
+	}
+
+	/**
+	 * Has frames whose header falls in these windows run through a
+	 * decoder. Call it once for each preamble the decoder accepts, e.g.
+	 * again for its repeat frame.
+	 *
+	 * Parameters:
+	 *      slot: From addDecoder().
+	 *      mark_min, mark_max: The header mark window in ticks.
+	 *      space_min, space_max: The header space window in ticks.
+	 *
+	 * Return: Nothing
+	 */
+	void addPreamble(int8_t slot, uint16_t mark_min, uint16_t mark_max,
+			uint16_t space_min, uint16_t space_max) {
+		if ((slot < 0) || (slot >= _num_decoders)) {
+			return;
+		}
+
+		indexWindow(_mark_buckets, (uint8_t)slot, mark_min, mark_max);
+		indexWindow(_space_buckets, (uint8_t)slot, space_min, space_max);
+	}
+
+	/**
+	 * Registers decodeResultPulseDistance() for a pulse distance protocol
+	 * descriptor, with its header and (if it has one) repeat preamble.
+	 *
+	 * Parameters:
+	 *      protocol: The id for result->protocol.
+	 *
+	 * Return: The same as addDecoder().
+	 */
+	template <class Protocol>
+	int8_t addPulseDistance(uint8_t protocol) {
+		typedef IR_PulseDistanceWindows<Protocol> Windows;
+		int8_t slot = addDecoder(
+			decodeResultPulseDistance<Protocol, ir_segment_t>, protocol);
+
+		addPreamble(slot, Windows::HeaderMark::lo, Windows::HeaderMark::hi,
+			Windows::HeaderSpace::lo, Windows::HeaderSpace::hi);
+		if (Protocol::repeat_mark_us != 0) {
+			addPreamble(slot, Windows::RepeatMark::lo,
+				Windows::RepeatMark::hi, Windows::RepeatSpace::lo,
+				Windows::RepeatSpace::hi);
+		}
+		return slot;
+	}
+
+	/**
+	 * The decoders whose preambles a header fits, one bit per slot.
+	 */
+	mask_t getCandidates(uint16_t mark, uint16_t space) {
+		return _mark_buckets[irPreambleBucket(mark)]
+			& _space_buckets[irPreambleBucket(space)];
+	}
+
+	/**
+	 * Decodes a frame with whichever registered decoder its preamble
+	 * selects.
+	 *
+	 * Parameters:
+	 *      segments: The recorded segments, starting with the header mark.
+	 *      count: The number of segments recorded.
+	 *      result: Filled in, see ir_decode_result_t.
+	 *      timestamp: Copied to result->timestamp.
+	 *
+	 * Return: IR_E_OK or IR_E_REPEAT from the first candidate that
+	 *      decodes the frame. Otherwise the first candidate's error, or
+	 *      IR_E_INVALID_START_OF_FRAME if no decoder's preamble fits.
+	 */
+	int8_t decode(const ir_segment_t *segments, uint8_t count,
+			ir_decode_result_t *result, uint32_t timestamp = 0) {
+		mask_t candidates;
+		int8_t res = IR_E_INVALID_START_OF_FRAME;
+		int8_t candidate_res;
+
+		result->timestamp = timestamp;
+		result->flags = 0;
+		result->quality = 0;
+
+		if (count < 2) {
+			return IR_E_SHORT_FRAME;
+		}
+
+		candidates = getCandidates(segments[0].duration,
+			segments[1].duration);
+		for (uint8_t slot = 0; 0 != candidates; slot++, candidates >>= 1) {
+			/* A byte at a time past decoders that don't fit, so the last
+			 * slot is as quick to reach as the first
+			 */
+			while (0 == (uint8_t)candidates) {
+				candidates >>= 8;
+				slot += 8;
+			}
+			if (0 == (candidates & 1)) {
+				continue;
+			}
+
+			candidate_res = _decoders[slot](segments, count,
+				_protocols[slot], result);
+			if (IR_E_OK <= candidate_res) {
+				return candidate_res;
+			}
+			/* Report why the first candidate failed */
+			if (IR_E_INVALID_START_OF_FRAME == res) {
+				res = candidate_res;
+			}
+		}
+
+		return res;
+	}
+
+	int8_t decode(IR_BufferingStreamDecoder *bufferedDecoder,
+			ir_decode_result_t *result, uint32_t timestamp = 0) {
+		return decode(bufferedDecoder->getSegmentBuffer(),
+			bufferedDecoder->getSegmentCount(), result, timestamp);
+	}
+
+	int8_t decode(const ir_frame_view_t *frame, ir_decode_result_t *result,
+			uint32_t timestamp = 0) {
+		return decode(frame->segments, frame->count, result, timestamp);
+	}
+
+	uint8_t getDecoderCount(void) {
+		return _num_decoders;
+	}
+};
+
+/**
+ * Compile-time bound alternative to IR_HwInterface. It's templated on the
+ * decoder type and calls its edgeEvent() and endOfFrameEvent() directly
+ * instead of through the IR_StreamDecoder vtable, so a decoder defined in a
+ * header (or in your sketch) can be inlined right into the ISR.
+ *
+ * The decoder doesn't even need to derive from IR_StreamDecoder; it only
+ * needs the two methods.
+ *
+ * Because the ISRs have to call this object rather than
+ * IR_InputCaptureInterface, put IR_STATIC_HW_INTERFACE_ISRS() at file scope
+ * in your sketch:
+ *
+ *  SamsungStreamingDecoder decoder;
+ *  IR_StaticHwInterface<SamsungStreamingDecoder> hw;
+ *  IR_STATIC_HW_INTERFACE_ISRS(hw)
+ *
+ *  void setup() {
+ *      hw.setup(&decoder, 8, IR_POLARITY_AUTO);
+ *  }
+ *
+ * See IR_HwInterface for what each method does.
+ */
+template <class Decoder>
+class IR_StaticHwInterface {
+private:
+	Decoder *_decoder;
+
+public:
+	IR_StaticHwInterface(void) {
+		_decoder = NULL;
+	}
+
+	void setup(Decoder *stream_decoder, uint8_t pin,
+			ir_polarity_t polarity, uint16_t end_of_frame_us = 0,
+			ir_timer_mode_t timer_mode = IR_TIMER_RESET_ON_EDGE) {
+		IR_HAL_DISABLE_INTERRUPTS();
+		_decoder = stream_decoder;
+		irHalSetup(pin, polarity, irEndOfFrameTicks(end_of_frame_us),
+			timer_mode);
+		IR_HAL_ENABLE_INTERRUPTS();
+	}
+
+	inline void captureInterrupt(void) {
+		uint16_t elapsed = irHalCaptureEdge();
+
+		/* Qualified so that it's never a virtual call */
+		_decoder->Decoder::edgeEvent(elapsed);
+	}
+
+	inline void overflowInterrupt(void) {
+		irHalEndOfFrame();
+		_decoder->Decoder::endOfFrameEvent();
+	}
+};
+
+/**
+ * Points the capture and end-of-frame interrupts at an IR_StaticHwInterface
+ * instead of IR_InputCaptureInterface. Use it once, at file scope.
+ */
+#if defined(IR_HAL_AVR)
+#define IR_STATIC_HW_INTERFACE_ISRS(hw) \
+	ISR(TIMER1_CAPT_vect) { (hw).captureInterrupt(); } \
+	ISR(TIMER1_OVF_vect) { (hw).overflowInterrupt(); } \
+	ISR(TIMER1_COMPA_vect) { (hw).overflowInterrupt(); }
+#else
+#define IR_STATIC_HW_INTERFACE_ISRS(hw) \
+	void irHostCaptureVector(void) { (hw).captureInterrupt(); } \
+	void irHostOverflowVector(void) { (hw).overflowInterrupt(); }
+#endif
+
 #endif
 
@@ -0,0 +1,103 @@
+/*---------------------------------------------------------------------------
+ * Streaming Infrared Decoder Library
+ *
+ * Copyright (c) 2013, Bryan Thomas (BTHI) and Christopher Myers
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *---------------------------------------------------------------------------
+ *
+ * Hardware abstraction layer used by IR_HwInterface. Everything that touches
+ * timer registers lives behind these few functions, so the rest of the
+ * library (and the decoders in particular) can be built anywhere.
+ *
+ * Backends:
+ *   BTHI_IR_Hal_AVR.cpp  - Timer 1 input capture on the atmega328. Selected
+ *                          when building for an AVR.
+ *   BTHI_IR_Hal_Host.cpp - A timed software source for building and
+ *                          profiling on a regular computer. Selected when
+ *                          ARDUINO isn't defined. See irHostEdge().
+ */
+
+#ifndef BTHI_IR_HAL_H
+#define BTHI_IR_HAL_H
+
+#include <BTHI_IR_Decoder.h>
+
+#if defined(__AVR__)
+#define IR_HAL_AVR
+#elif !defined(ARDUINO)
+#define IR_HAL_HOST
+#else
+#error "BTHI_IR_Decoder only supports AVR boards (and host builds)"
+#endif
+
+/**
+ * Guards the few places where the application side changes state that the
+ * capture handlers also use.
+ */
+#if defined(IR_HAL_AVR)
+#define IR_HAL_DISABLE_INTERRUPTS()     cli()
+#define IR_HAL_ENABLE_INTERRUPTS()      sei()
+#else
+#define IR_HAL_DISABLE_INTERRUPTS()     irHalDisableInterrupts()
+#define IR_HAL_ENABLE_INTERRUPTS()      irHalEnableInterrupts()
+
+extern void irHalDisableInterrupts(void);
+extern void irHalEnableInterrupts(void);
+#endif
+
+/**
+ * Constant lookup tables. The AVR has 32K of flash and 2K of RAM, so tables
+ * are left in flash and read with lpm. On the host they're ordinary arrays.
+ *
+ *  static const uint8_t table[16] IR_HAL_TABLE = { ... };
+ *  value = IR_HAL_READ_TABLE(&table[i]);
+ */
+#if defined(IR_HAL_AVR)
+#include <avr/pgmspace.h>
+#define IR_HAL_TABLE                    PROGMEM
+#define IR_HAL_READ_TABLE(address)      pgm_read_byte(address)
+#else
+#define IR_HAL_TABLE
+#define IR_HAL_READ_TABLE(address)      (*(address))
+#endif
+
+/**
+ * Starts capturing edges on the given pin. The first edge captured is chosen
+ * according to polarity. The end of frame is signalled end_of_frame_ticks
+ * after the last edge, or after 65536 ticks if it's 0. timer_mode says how
+ * the time between edges is measured. Called from IR_HwInterface::setup().
+ */
+extern void irHalSetup(uint8_t pin, ir_polarity_t polarity,
+        uint16_t end_of_frame_ticks, ir_timer_mode_t timer_mode);
+
+/**
+ * Called at the start of IR_HwInterface::captureInterrupt(). Acknowledges the
+ * edge, gets ready for the next one (in the opposite direction) and arms the
+ * end-of-frame timeout.
+ *
+ * Return: The number of ticks since the previous edge.
+ */
+extern uint16_t irHalCaptureEdge(void);
+
+/**
+ * Called at the start of IR_HwInterface::overflowInterrupt(). Disarms the
+ * end-of-frame timeout until the next edge.
+ */
+extern void irHalEndOfFrame(void);
+
+#endif
@@ -0,0 +1,225 @@
+/*---------------------------------------------------------------------------
+ * Streaming Infrared Decoder Library
+ *
+ * Copyright (c) 2013, Bryan Thomas (BTHI) and Christopher Myers
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *---------------------------------------------------------------------------
+ *
+ * AVR backend for the hardware abstraction layer (see BTHI_IR_Hal.h). Uses
+ * the input capture and overflow interrupts of Timer 1. See
+ * BTHI_IR_Decoder.cpp for the pros and cons of this approach.
+ */
+#if defined(__AVR__)
+
+#include <Arduino.h>
+#include <BTHI_IR_Decoder.h>
+#include <BTHI_IR_Hal.h>
+
+/* Which interrupt signals the end of a frame: the overflow, or output compare
+ * A when a shorter gap was asked for.
+ */
+static uint8_t g_end_of_frame_interrupt = (1 << TOIE1);
+static uint8_t g_end_of_frame_flag = (1 << TOV1);
+
+/* See ir_timer_mode_t */
+static ir_timer_mode_t g_timer_mode = IR_TIMER_RESET_ON_EDGE;
+
+/* End-of-frame gap and the previous ICR1, only used when free running */
+static uint16_t g_end_of_frame_ticks;
+static uint16_t g_last_capture;
+
+/**
+ * Sets up Timer1 to do input capture and chooses an initial level to capture
+ * on based on your polarity setting. It also sets the specified pin to be an
+ * INPUT. See IR_HwInterface::setup() for the meaning of the parameters.
+ *
+ * Since TCNT1 is reset on every edge, a compare match on OCR1A happens
+ * exactly end_of_frame_ticks after the last edge, which is what we use for a
+ * shorter end-of-frame gap. When the timer is free running there is no
+ * overflow relative to the last edge, so output compare A is always used and
+ * OCR1A is moved along with every edge instead.
+ *
+ * Interrupts are expected to be disabled by the caller.
+ *
+ * Return: Nothing
+ */
+void irHalSetup(uint8_t pin, ir_polarity_t polarity,
+        uint16_t end_of_frame_ticks, ir_timer_mode_t timer_mode) {
+    g_timer_mode = timer_mode;
+    g_end_of_frame_ticks = end_of_frame_ticks;
+    g_last_capture = 0;
+
+    if (IR_TIMER_FREE_RUNNING == timer_mode) {
+        g_end_of_frame_interrupt = (1 << OCIE1A);
+        g_end_of_frame_flag = (1 << OCF1A);
+    } else if (0 == end_of_frame_ticks) {
+        g_end_of_frame_interrupt = (1 << TOIE1);
+        g_end_of_frame_flag = (1 << TOV1);
+    } else {
+        OCR1A = end_of_frame_ticks;
+        g_end_of_frame_interrupt = (1 << OCIE1A);
+        g_end_of_frame_flag = (1 << OCF1A);
+    }
+
+    /* Set Initial Timer value */
+    TCNT1 = 0;
+    
+    /* Put timer 1 into "Normal" mode for input capture */
+    TCCR1A = 0;
+
+    if (IR_POLARITY_AUTO == polarity) {
+        /* Have to set the pin mode to input early if it's auto to read the
+         * level.  We'll call this again later, but that shouldn't have any
+         * side effects.
+         */
+        pinMode(pin, INPUT);
+    
+        if (0 == digitalRead(pin)) {
+            /* First edge is rising */
+            TCCR1B |= (1 << ICES1);
+        } else {
+            /* First edge is falling */
+            TCCR1B &= ~(1 << ICES1);
+        }
+    } else if (IR_POLARITY_LOW == polarity) {
+        /* First edge is rising */
+        TCCR1B |= (1 << ICES1);
+    } else {
+        /* First edge is falling */
+        TCCR1B &= ~(1 << ICES1);
+    }
+
+    /* Enable input capture interrupts only */
+    TIMSK1 = (1 << ICIE1);
+
+    /* Noise cancellation on and prescaler /8. This gives a tick period of 
+     * 0.5us (see IR_TICK_PERIOD_NS):
+     *
+     *      1 / (16000000 Hz /8) = 0.5us
+     */
+    TCCR1B = (1 << ICNC1) | (1 << CS11);
+
+    /* The pin needs to be an input for input capture to work */
+    pinMode(pin, INPUT);
+}
+
+/**
+ * At the time the capture interrupt fires, Timer 1 has already cleared the
+ * interrupt flag, and TCNT has been latched into the ICR1 register (and
+ * continues to run). We need to reset TCNT back to 0 as quickly as possible
+ * so that ICR1 always contains the number of 0.5us ticks since the last edge.
+ * This means we don't need to do any now-then math to figure out elapsed
+ * time. The catch is that whatever TCNT1 counted between the edge and the
+ * reset (the ISR entry latency, plus any time other interrupts held us off)
+ * is lost from the next duration.
+ *
+ * In IR_TIMER_FREE_RUNNING mode, TCNT1 is left alone and we do the now-then
+ * math instead: ICR1 minus the previous ICR1. Unsigned 16-bit arithmetic
+ * takes care of the timer wrapping around, since no duration we keep can be
+ * longer than 0xFFFF ticks. The end of frame is then OCR1A = ICR1 + the gap,
+ * where a gap of 0 means a full trip around the timer, the same 65536 ticks
+ * as the overflow in the other mode.
+ *
+ * Next, we'll enable the overflow (or compare) interrupt (see
+ * IR_HwInterface::overflowInterrupt) which will fire if we don't get another
+ * edge before the end-of-frame gap.
+ *
+ * Return: The number of ticks since the previous edge.
+ */
+uint16_t irHalCaptureEdge(void) {
+    uint16_t elapsed;
+    uint16_t capture;
+    uint8_t level;
+    
+    if (IR_TIMER_FREE_RUNNING == g_timer_mode) {
+        /* ICR1 contains TCNT1 value at the time of the edge event */
+        capture = ICR1;
+        elapsed = capture - g_last_capture;
+        g_last_capture = capture;
+
+        OCR1A = capture + g_end_of_frame_ticks;
+    } else {
+        /* Reset TCNT1 */
+        TCNT1 = 0;
+
+        /* ICR1 contains TCNT1 value at the time of the edge event */
+        elapsed = ICR1;
+    }
+    
+    /* Start listening for the end of frame as well as the input capture
+     * interrupt. Make sure to clear its flag, otherwise it will trigger
+     * immediately, giving us a premature end of frame
+     */
+    TIFR1 = g_end_of_frame_flag;
+    TIMSK1 = (1 << ICIE1) | g_end_of_frame_interrupt;
+
+    /* Figure out what the current level is by looking at what condition we
+     * had used to capture the edge.  If it was rising, the level is obviously
+     * HIGH and we need to now look for a falling edge (and vice versa).
+     */
+    level = (TCCR1B & (1 << ICES1)) != 0 ? HIGH : LOW;
+
+    if (LOW == level) {
+        /* Next edge is rising */
+        TCCR1B |= (1 << ICES1);
+    } else {
+        /* Next edge is falling */
+        TCCR1B &= ~(1 << ICES1);
+    }
+
+    return elapsed;
+}
+
+/**
+ * No more end of frame interrupt until it is re-enabled in the capture
+ * interrupt.
+ *
+ * Return: Nothing
+ */
+void irHalEndOfFrame(void) {
+    TIMSK1 &= ~g_end_of_frame_interrupt;
+}
+
+/**
+ * ISR - Timer1 Capture Interrupt. This function will go into the vector 
+ * table. See IR_HwInterface::captureInterrupt() for more details.
+ *
+ * Both ISRs are weak so that IR_STATIC_HW_INTERFACE_ISRS() can replace them.
+ */
+ISR(TIMER1_CAPT_vect, __attribute__((weak))) {
+    IR_InputCaptureInterface.captureInterrupt();
+}
+
+/**
+ * ISR - Timer1 Overflow Interrupt. This function will go into the vector 
+ * table. See IR_HwInterface::overflowInterrupt() for more details.
+ */
+ISR(TIMER1_OVF_vect, __attribute__((weak))) {
+    IR_InputCaptureInterface.overflowInterrupt();
+}
+
+/**
+ * ISR - Timer1 Compare A Interrupt. Only enabled when IR_HwInterface::setup()
+ * is given a shorter end-of-frame gap. See
+ * IR_HwInterface::overflowInterrupt() for more details.
+ */
+ISR(TIMER1_COMPA_vect, __attribute__((weak))) {
+    IR_InputCaptureInterface.overflowInterrupt();
+}
+
+#endif
@@ -0,0 +1,220 @@
+/*---------------------------------------------------------------------------
+ * Streaming Infrared Decoder Library
+ *
+ * Copyright (c) 2013, Bryan Thomas (BTHI) and Christopher Myers
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *---------------------------------------------------------------------------
+ *
+ * Host backend for the hardware abstraction layer (see BTHI_IR_Hal.h). There
+ * is no timer here. Instead, the program says when each edge happens (in
+ * ticks, see IR_TICK_PERIOD_NS) with irHostEdge() and the backend works out
+ * the elapsed durations and end-of-frame timeouts exactly the way Timer 1
+ * would, then calls the same IR_HwInterface handlers the ISRs do. It can also
+ * be told how late the capture ISR runs, to see what that does to the
+ * durations in each ir_timer_mode_t.
+ *
+ * "Interrupts" are modelled with a mutex: the handlers run while holding it,
+ * and IR_HAL_DISABLE_INTERRUPTS() takes it. That means edges can be fed from
+ * one thread while another plays the part of loop().
+ *
+ * Build with something like:
+ *
+ *  g++ -O2 -I. BTHI_IR_Decoder.cpp BTHI_IR_Hal_Host.cpp my_program.cpp \
+ *      -lpthread
+ */
+#if !defined(ARDUINO)
+
+#include <pthread.h>
+#include <time.h>
+#include <BTHI_IR_Decoder.h>
+#include <BTHI_IR_Hal.h>
+
+/* Ticks without an edge before the end of the frame is signalled by
+ * default. This matches a 16-bit Timer 1 overflowing.
+ */
+#define IR_HOST_END_OF_FRAME_TICKS  0x10000UL
+
+static pthread_mutex_t g_interrupt_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Time of the most recent edge, in ticks */
+static uint32_t g_last_edge;
+
+/* The end-of-frame gap in ticks, as given to irHalSetup() */
+static uint32_t g_end_of_frame_ticks = IR_HOST_END_OF_FRAME_TICKS;
+
+/* See ir_timer_mode_t */
+static ir_timer_mode_t g_timer_mode = IR_TIMER_RESET_ON_EDGE;
+
+/* When TCNT1 was last 0, in ticks. Only moves in IR_TIMER_RESET_ON_EDGE */
+static uint32_t g_timer_zero;
+
+/* When the end of frame is due, in ticks */
+static uint32_t g_end_of_frame_at;
+
+/* Set while the end-of-frame timeout is armed, like TOIE1 */
+static uint8_t g_end_of_frame_armed;
+
+/* Duration for irHalCaptureEdge() to hand out, like ICR1 */
+static uint16_t g_captured;
+
+void irHalDisableInterrupts(void) {
+    pthread_mutex_lock(&g_interrupt_lock);
+}
+
+void irHalEnableInterrupts(void) {
+    pthread_mutex_unlock(&g_interrupt_lock);
+}
+
+/**
+ * Nothing to configure on the host besides the end-of-frame gap. Just forget
+ * about any previous frame. The pin and polarity don't mean anything here.
+ *
+ * Return: Nothing
+ */
+void irHalSetup(uint8_t, ir_polarity_t, uint16_t end_of_frame_ticks,
+        ir_timer_mode_t timer_mode) {
+    g_end_of_frame_ticks = (0 == end_of_frame_ticks) ?
+        IR_HOST_END_OF_FRAME_TICKS : end_of_frame_ticks;
+    g_timer_mode = timer_mode;
+    g_timer_zero = 0;
+    g_end_of_frame_at = 0;
+    g_last_edge = 0;
+    g_end_of_frame_armed = 0;
+    g_captured = 0;
+}
+
+uint16_t irHalCaptureEdge(void) {
+    g_end_of_frame_armed = 1;
+    return g_captured;
+}
+
+void irHalEndOfFrame(void) {
+    g_end_of_frame_armed = 0;
+}
+
+/**
+ * The host equivalents of the Timer 1 interrupt vectors. Like the AVR ISRs,
+ * they're weak so that IR_STATIC_HW_INTERFACE_ISRS() can replace them.
+ */
+__attribute__((weak)) void irHostCaptureVector(void) {
+    IR_InputCaptureInterface.captureInterrupt();
+}
+
+__attribute__((weak)) void irHostOverflowVector(void) {
+    IR_InputCaptureInterface.overflowInterrupt();
+}
+
+/**
+ * Lets time pass without any edges. If it's been long enough since the last
+ * edge, the end of frame is signalled just as the Timer 1 overflow would.
+ *
+ * Parameters:
+ *      now: The current time in ticks. Must not go backwards.
+ *
+ * Return: Nothing
+ */
+void irHostIdle(uint32_t now) {
+    pthread_mutex_lock(&g_interrupt_lock);
+    if ((0 != g_end_of_frame_armed)
+            && ((int32_t)(now - g_end_of_frame_at) >= 0)) {
+        irHostOverflowVector();
+    }
+    pthread_mutex_unlock(&g_interrupt_lock);
+}
+
+/**
+ * Signals an edge on the input. If the previous frame should have ended in
+ * the meantime, that's signalled first. The duration handed to the decoder
+ * is truncated to 16 bits, as it would be on the real timer.
+ *
+ * Parameters:
+ *      now: The time of the edge in ticks. Must not go backwards.
+ *      isr_latency: How many ticks after the edge the capture ISR gets to
+ *          run. In IR_TIMER_RESET_ON_EDGE mode this is when TCNT1 is
+ *          cleared, so it comes off the next duration. Should be less than
+ *          the time to the next edge.
+ *
+ * Return: Nothing
+ */
+void irHostEdge(uint32_t now, uint16_t isr_latency) {
+    uint16_t capture;
+
+    irHostIdle(now);
+
+    pthread_mutex_lock(&g_interrupt_lock);
+
+    /* What ICR1 latched at the edge */
+    capture = (uint16_t)(now - g_timer_zero);
+
+    if (IR_TIMER_FREE_RUNNING == g_timer_mode) {
+        g_captured = capture - (uint16_t)(g_last_edge - g_timer_zero);
+        g_end_of_frame_at = now + g_end_of_frame_ticks;
+    } else {
+        g_captured = capture;
+        g_timer_zero = now + isr_latency;
+        g_end_of_frame_at = g_timer_zero + g_end_of_frame_ticks;
+    }
+
+    g_last_edge = now;
+    irHostCaptureVector();
+    pthread_mutex_unlock(&g_interrupt_lock);
+}
+
+/**
+ * Plays a whole frame into the decoder: a leading edge, one edge at the end
+ * of each segment and then the end-of-frame timeout.
+ *
+ * Parameters:
+ *      start: The time of the leading edge in ticks.
+ *      segments: The segment durations, as a buffering decoder records them.
+ *      count: The number of segments.
+ *      real_time: If non-zero, sleep between edges so that the frame takes
+ *          as long as it would from a real remote. Otherwise, go as fast as
+ *          possible.
+ *
+ * Return: The time (in ticks) at which the end of frame was signalled.
+ */
+uint32_t irHostReplay(uint32_t start, const ir_segment_t *segments,
+        uint16_t count, uint8_t real_time) {
+    uint32_t now = start;
+    struct timespec delay;
+
+    irHostEdge(now);
+    for (uint16_t i = 0; i < count; i++) {
+        if (0 != real_time) {
+            delay.tv_sec = 0;
+            delay.tv_nsec = (long)segments[i].duration * IR_TICK_PERIOD_NS;
+            nanosleep(&delay, NULL);
+        }
+
+        now += segments[i].duration;
+        irHostEdge(now);
+    }
+
+    now += g_end_of_frame_ticks;
+    if (0 != real_time) {
+        delay.tv_sec = 0;
+        delay.tv_nsec = (long)g_end_of_frame_ticks * IR_TICK_PERIOD_NS;
+        nanosleep(&delay, NULL);
+    }
+    irHostIdle(now);
+
+    return now;
+}
+
+#endif
@@ -0,0 +1,76 @@
+/*----------------------------------------------------------------------------------
+ * Example using the Universal IR decoding library to decode whichever remote
+ * is pointed at it.
+ *
+ * decodeFrameAny() works out the protocol and fills in an ir_decode_result_t
+ * with the address and command, the raw bits, whether it was a repeat, when
+ * it arrived and how clean the timing was. Keep passing the same result and
+ * repeat frames come back with the code they repeat.
+ */
+#include <BTHI_IR_Decoder.h>
+
+IR_BufferingStreamDecoder decoder;
+
+/* Room for 80 segments.  Samsung and Apple frames are 67 edges long. */
+#define NUM_SEGMENTS  80
+
+ir_segment_t g_segment_buffer[NUM_SEGMENTS];
+
+ir_decode_result_t g_result;
+
+void setup() {
+  Serial.begin(115200);
+  Serial.println("\n--- BTHI Any Protocol Decoding Example ---\n");
+
+  decoder.setSegmentBuffer(g_segment_buffer, NUM_SEGMENTS);
+
+  /* Use Pin 8 (the input capture pin on the UNO) */
+  IR_InputCaptureInterface.setup(&decoder, 8, IR_POLARITY_AUTO);
+}
+
+void loop() {
+  int8_t res;
+
+  if (decoder.isFrameAvailable()) {
+    res = decodeFrameAny(&decoder, &g_result, millis());
+
+    if (res >= IR_E_OK) {
+      Serial.print(g_result.timestamp);
+      Serial.print("ms ");
+      switch (g_result.protocol) {
+        case IR_PROTOCOL_SAMSUNG:
+          Serial.print("Samsung");
+          break;
+        case IR_PROTOCOL_APPLE:
+          Serial.print("Apple");
+          break;
+        default:
+          Serial.print("Unknown");
+          break;
+      }
+      Serial.print(" address 0x");
+      Serial.print(g_result.address, HEX);
+      Serial.print(" command 0x");
+      Serial.print(g_result.command, HEX);
+      Serial.print(" (0x");
+      Serial.print(irGetResultData(&g_result), HEX);
+      Serial.print(")");
+      if (g_result.flags & IR_RESULT_F_REPEAT) {
+        Serial.print(" repeat");
+      }
+      Serial.print(" quality ");
+      Serial.println(g_result.quality);
+    } else if (res == IR_E_INVALID_START_OF_FRAME) {
+      Serial.println("ERROR: Not a protocol we know!");
+    } else if (res == IR_E_INVALID_END_OF_FRAME) {
+      Serial.println("ERROR: Invalid end of frame!");
+    } else if (res == IR_E_SHORT_FRAME) {
+      Serial.println("ERROR: Short frame!");
+    } else {
+      Serial.println("ERROR: Unknown!");
+    }
+
+    /* This will allow the decoder to accept another frame */
+    decoder.readyForNextFrame();
+  }
+}
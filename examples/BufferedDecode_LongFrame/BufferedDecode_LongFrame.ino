@@ -0,0 +1,88 @@
+/*----------------------------------------------------------------------------------
+ * Example using the Universal IR decoding library to receive the long frames
+ * air conditioner remotes send.
+ *
+ * Instead of a button code, an air conditioner remote sends its whole state
+ * (mode, temperature, fan...) every time, usually as 100-300 bits. That's more
+ * than the 255 segments IR_BufferingStreamDecoder can hold and more than fits
+ * in a uint32_t, so this uses an IR_FixedBufferingStreamDecoder big enough for
+ * the frame and decodeFramePulseDistanceLong(), and prints the payload as hex
+ * bytes.
+ *
+ * The timings below are typical of Mitsubishi units. Adjust them for your remote;
+ * BufferedDecode_Generic will show you what it sends.
+ */
+#include <BTHI_IR_Decoder.h>
+
+struct AirConditionerProtocol {
+  static const uint16_t header_mark_us = 3400;
+  static const uint16_t header_space_us = 1750;
+  static const uint16_t header_tolerance_us = 300;
+  static const uint16_t bit_mark_us = 450;
+  static const uint16_t zero_space_us = 420;
+  static const uint16_t one_space_us = 1300;
+  static const uint16_t bit_tolerance_us = 150;
+  static const uint8_t num_bits = 0;          // However many the remote sends
+  static const uint16_t trailer_mark_us = 450;
+  static const uint16_t repeat_mark_us = 0;   // No repeat frames
+  static const uint16_t repeat_space_us = 0;
+};
+
+/* Room for 320 segments, which is 158 bits plus the header and trailer. The
+ * counts are 16 bits wide for this buffer only. */
+#define NUM_SEGMENTS  320
+#define MAX_BITS      ((NUM_SEGMENTS - 3) / 2)
+
+IR_FixedBufferingStreamDecoder<NUM_SEGMENTS> decoder;
+
+uint8_t g_payload[(MAX_BITS + 7) / 8];
+
+void setup() {
+  Serial.begin(115200);
+  Serial.println("\n--- BTHI Long Frame Decoding Example ---\n");
+
+  /* Use Pin 8 (the input capture pin on the UNO). Many of these remotes send
+   * the frame twice about 10ms apart, so end frames after 8ms of quiet. */
+  IR_InputCaptureInterface.setup(&decoder, 8, IR_POLARITY_AUTO, 8000);
+}
+
+void loop() {
+  uint16_t num_bits;
+  int8_t res;
+
+  if (decoder.isFrameAvailable()) {
+    res = decodeFramePulseDistanceLong<AirConditionerProtocol>(&decoder,
+      g_payload, MAX_BITS, &num_bits);
+
+    if (res == IR_E_OK) {
+      Serial.print("Received ");
+      Serial.print(num_bits);
+      Serial.print(" bits:");
+      for (uint16_t i = 0; i < (num_bits + 7) / 8; i++) {
+        Serial.print(" ");
+        if (g_payload[i] < 0x10) {
+          Serial.print("0");
+        }
+        Serial.print(g_payload[i], HEX);
+      }
+      Serial.println();
+    } else if (res == IR_E_PAYLOAD_TOO_LONG) {
+      Serial.println("ERROR: More bits than g_payload holds!");
+    } else if (res == IR_E_INVALID_START_OF_FRAME) {
+      Serial.println("ERROR: Invalid start of frame!");
+    } else if (res == IR_E_INVALID_END_OF_FRAME) {
+      Serial.println("ERROR: Invalid end of frame!");
+    } else if (res == IR_E_SHORT_FRAME) {
+      Serial.println("ERROR: Short frame!");
+    } else {
+      Serial.println("ERROR: Unknown!");
+    }
+
+    if (decoder.getSegmentOverflowCount() > 0) {
+      Serial.println("WARNING: The frame didn't fit in the buffer!");
+    }
+
+    /* This will allow the decoder to accept another frame */
+    decoder.readyForNextFrame();
+  }
+}
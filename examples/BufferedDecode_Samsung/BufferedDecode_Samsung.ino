@@ -37,8 +37,12 @@ void loop() {
       Serial.print(" (0x");
       Serial.print(data, HEX);
       Serial.println(")");
+    } else if (res == IR_E_REPEAT) {
+      Serial.println("Repeat (key held)");
     } else if (res == IR_E_INVALID_START_OF_FRAME) {
       Serial.println("ERROR: Invalid start of frame!");
+    } else if (res == IR_E_INVALID_END_OF_FRAME) {
+      Serial.println("ERROR: Invalid end of frame!");
     } else if (res == IR_E_SHORT_FRAME) {
       Serial.println("ERROR: Short frame!");
     } else {
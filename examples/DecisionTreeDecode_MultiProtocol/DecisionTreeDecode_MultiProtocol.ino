@@ -0,0 +1,56 @@
+/*----------------------------------------------------------------------------------
+ * Decision Tree Decode Example using the BTHI Universal IR decoding library.
+ *
+ * This example decodes Samsung and Apple remotes without buffering the frame,
+ * like StreamingDecode_MultiProtocol, but the set of protocols is fixed at
+ * compile time. IR_DecisionTreeStreamDecoder turns the header windows of all
+ * of them into one binary search, so the header mark and space pick the
+ * protocol in a few compares against constants, and IR_StaticHwInterface lets
+ * the compiler inline the whole thing into the capture interrupt.
+ *
+ * Add protocols by adding IR_TreeProtocol entries to the list, each with its
+ * own id for getProtocol().
+ */
+#include <BTHI_IR_Decoder.h>
+#include <BTHI_IR_DecisionTree.h>
+
+typedef IR_DecisionTreeStreamDecoder<
+  IR_TreeProtocol<IR_ProtocolSamsung, IR_PROTOCOL_SAMSUNG>,
+  IR_TreeProtocol<IR_ProtocolApple, IR_PROTOCOL_APPLE> > TreeDecoder;
+
+TreeDecoder decoder;
+IR_StaticHwInterface<TreeDecoder> hw;
+IR_STATIC_HW_INTERFACE_ISRS(hw)
+
+void setup() {
+  Serial.begin(115200);
+  Serial.println("\n--- BTHI Decision Tree Decode Example ---\n");
+
+  // Use Pin 8 (the input capture pin on the UNO)
+  hw.setup(&decoder, 8, IR_POLARITY_AUTO);
+}
+
+void loop() {
+  if (decoder.isFrameAvailable()) {
+    switch (decoder.getProtocol()) {
+      case IR_PROTOCOL_SAMSUNG:
+        Serial.print("Samsung: 0x");
+        break;
+      case IR_PROTOCOL_APPLE:
+        Serial.print("Apple: 0x");
+        break;
+    }
+    // Repeat frames report the frame they repeat
+    Serial.print(decoder.getData(), HEX);
+    if (decoder.isRepeatFrame()) {
+      Serial.print(" (repeat)");
+    }
+    Serial.println();
+
+    Serial.print("Unmatched frames so far: ");
+    Serial.println(decoder.getUnmatchedFrameCount());
+
+    // This will allow the decoder to accept another frame
+    decoder.readyForNextFrame();
+  }
+}
@@ -0,0 +1,60 @@
+/*----------------------------------------------------------------------------------
+ * Example using the Universal IR decoding library with a buffering decoder that
+ * receives into one buffer while you work on the frame in the other.
+ *
+ * With one buffer, BufferedDecode_Samsung misses any frame that arrives while
+ * loop() is still busy with the last one. Here the decoder lends each frame to
+ * loop() in place and carries on receiving into the other buffer, so a slow
+ * loop() (the delay() below stands in for real work) still sees every frame.
+ */
+#include <BTHI_IR_Decoder.h>
+
+IR_BufferingStreamDecoder decoder;
+
+/* Two buffers of 72 segments. Samsung frames are 67 edges long. */
+#define NUM_SEGMENTS  72
+#define NUM_BUFFERS   2
+
+ir_segment_t g_segment_buffers[NUM_BUFFERS * NUM_SEGMENTS];
+
+void setup() {
+  Serial.begin(115200);
+  Serial.println("\n--- BTHI Double Buffered Samsung Decoding Example ---\n");
+
+  /* Set up the decoder first. Give it both buffers */
+  decoder.setSegmentBuffers(g_segment_buffers, NUM_SEGMENTS, NUM_BUFFERS);
+
+  /* Hand each frame over as soon as the trailing mark arrives */
+  decoder.setFrameLength(
+    IR_PulseDistanceWindows<IR_ProtocolSamsung>::frame_segments);
+
+  /* Use Pin 8 (the input capture pin on the UNO) */
+  IR_InputCaptureInterface.setup(&decoder, 8, IR_POLARITY_AUTO);
+}
+
+void loop() {
+  uint32_t data;
+  int8_t res;
+
+  if (decoder.isFrameAvailable()) {
+    /* The segments are read right where they were captured */
+    res = decodeFrameSamsung(&decoder, &data);
+    if (res == IR_E_OK) {
+      Serial.print("Received: 0x");
+      Serial.print(data, HEX);
+    } else if (res == IR_E_REPEAT) {
+      Serial.print("Repeat (key held)");
+    } else {
+      Serial.print("ERROR: ");
+      Serial.print(res);
+    }
+    Serial.print(", frames waiting: ");
+    Serial.println(decoder.getAvailableFrameCount());
+
+    /* Pretend to be busy. The next frame is still being received */
+    delay(100);
+
+    /* Give the buffer back so the decoder can receive into it again */
+    decoder.readyForNextFrame();
+  }
+}
@@ -0,0 +1,140 @@
+/*----------------------------------------------------------------------------------
+ * Benchmark for the duration matching helpers of the BTHI Universal IR decoding
+ * library.
+ *
+ * Measures how many CPU cycles a single "is this segment ~560us?" comparison
+ * costs with:
+ *   - the original floating-point IR_DURATION_MATCH_US macro (reproduced below
+ *     as FLOAT_DURATION_MATCH_US so that we can still compare against it)
+ *   - the integer IR_DURATION_MATCH_US macro
+ *   - IR_TickWindow<>::match()
+ *
+ * Timer 1 is run at the full 16 MHz clock (no prescaler) so TCNT1 counts CPU
+ * cycles directly. Don't call IR_InputCaptureInterface.setup() in this sketch;
+ * it would reconfigure the timer underneath us.
+ *
+ * Results are printed once on the serial port at 115200 baud.
+ */
+#include <BTHI_IR_Decoder.h>
+
+/* The macro as it shipped before IR_TickWindow existed */
+#define FLOAT_DURATION_MATCH_US(actual_ticks, expected_us, tolerance_us) \
+    ( \
+    (actual_ticks >= ((expected_us - tolerance_us) * (1e-6 / 5e-7))) && \
+    (actual_ticks <= ((expected_us + tolerance_us) * (1e-6 / 5e-7))) \
+    )
+
+#define NUM_ITERATIONS  256
+
+/* volatile so the compiler can't fold the comparisons away */
+volatile uint16_t g_duration = 1120;
+volatile uint8_t g_sink;
+
+/**
+ * Starts Timer 1 counting CPU cycles from zero.
+ */
+void startCycleCounter(void) {
+  TCCR1A = 0;
+  TCCR1B = 0;
+  TIMSK1 = 0;
+  TCNT1 = 0;
+  TCCR1B = (1 << CS10);
+}
+
+/**
+ * Stops Timer 1 and returns the number of cycles since startCycleCounter().
+ */
+uint16_t stopCycleCounter(void) {
+  TCCR1B = 0;
+  return TCNT1;
+}
+
+uint16_t benchEmpty(void) {
+  uint16_t cycles;
+
+  startCycleCounter();
+  g_sink = (g_duration != 0);
+  cycles = stopCycleCounter();
+
+  return cycles;
+}
+
+uint16_t benchFloat(void) {
+  uint16_t cycles;
+
+  startCycleCounter();
+  g_sink = FLOAT_DURATION_MATCH_US(g_duration, 560, 100);
+  cycles = stopCycleCounter();
+
+  return cycles;
+}
+
+uint16_t benchIntegerMacro(void) {
+  uint16_t cycles;
+
+  startCycleCounter();
+  g_sink = IR_DURATION_MATCH_US(g_duration, 560, 100);
+  cycles = stopCycleCounter();
+
+  return cycles;
+}
+
+uint16_t benchTickWindow(void) {
+  uint16_t cycles;
+
+  startCycleCounter();
+  g_sink = IR_TickWindow<560, 100>::match(g_duration);
+  cycles = stopCycleCounter();
+
+  return cycles;
+}
+
+/**
+ * Runs one of the bench functions NUM_ITERATIONS times over a spread of
+ * durations and prints the worst and average cycle counts, less the cost of
+ * an empty measurement.
+ */
+void report(const char *name, uint16_t (*bench)(void), uint16_t overhead) {
+  uint32_t total = 0;
+  uint16_t worst = 0;
+  uint16_t cycles;
+
+  for (uint16_t i = 0; i < NUM_ITERATIONS; i++) {
+    g_duration = 900 + (i * 4);
+
+    /* Keep the serial ISR from landing in the middle of a measurement */
+    noInterrupts();
+    cycles = bench() - overhead;
+    interrupts();
+
+    total += cycles;
+    if (cycles > worst) {
+      worst = cycles;
+    }
+  }
+
+  Serial.print(name);
+  Serial.print(": avg ");
+  Serial.print(total / NUM_ITERATIONS);
+  Serial.print(" cycles, worst ");
+  Serial.print(worst);
+  Serial.println(" cycles");
+}
+
+void setup() {
+  uint16_t overhead;
+
+  Serial.begin(115200);
+  Serial.println("\n--- BTHI Duration Match Benchmark ---\n");
+
+  noInterrupts();
+  overhead = benchEmpty();
+  interrupts();
+
+  report("float macro (old)     ", benchFloat, overhead);
+  report("IR_DURATION_MATCH_US  ", benchIntegerMacro, overhead);
+  report("IR_TickWindow::match  ", benchTickWindow, overhead);
+}
+
+void loop() {
+}
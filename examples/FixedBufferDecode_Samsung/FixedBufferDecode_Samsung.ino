@@ -0,0 +1,55 @@
+/*----------------------------------------------------------------------------------
+ * Example using the Universal IR decoding library with a fixed-size buffering
+ * decoder that understands the Samsung IR protocol.
+ *
+ * IR_FixedBufferingStreamDecoder<N> owns its segment buffer, so there's no
+ * setSegmentBuffer() call, and IR_StaticHwInterface calls it directly from the
+ * ISRs. The result is the same as BufferedDecode_Samsung with a shorter, faster
+ * path from the capture interrupt to the buffer.
+ */
+#include <BTHI_IR_Decoder.h>
+
+/* Room for 72 segments. Samsung frames are 67 edges long. */
+typedef IR_FixedBufferingStreamDecoder<72> SamsungBuffer;
+
+SamsungBuffer decoder;
+IR_StaticHwInterface<SamsungBuffer> hw;
+IR_STATIC_HW_INTERFACE_ISRS(hw)
+
+void setup() {
+  Serial.begin(115200);
+  Serial.println("\n--- BTHI Fixed Buffer Samsung Decoding Example ---\n");
+
+  /* Hand the frame over as soon as the trailing mark arrives */
+  decoder.setFrameLength(
+    IR_PulseDistanceWindows<IR_ProtocolSamsung>::frame_segments);
+
+  /* Use Pin 8 (the input capture pin on the UNO) */
+  hw.setup(&decoder, 8, IR_POLARITY_AUTO);
+}
+
+void loop() {
+  uint32_t data;
+  int8_t res;
+
+  if (decoder.isFrameAvailable()) {
+    res = decodeFrameSamsung(&decoder, &data);
+    if (res == IR_E_OK) {
+      Serial.print("Received: 0x");
+      Serial.println(data, HEX);
+    } else if (res == IR_E_REPEAT) {
+      Serial.println("Repeat (key held)");
+    } else if (res == IR_E_INVALID_START_OF_FRAME) {
+      Serial.println("ERROR: Invalid start of frame!");
+    } else if (res == IR_E_INVALID_END_OF_FRAME) {
+      Serial.println("ERROR: Invalid end of frame!");
+    } else if (res == IR_E_SHORT_FRAME) {
+      Serial.println("ERROR: Short frame!");
+    } else {
+      Serial.println("ERROR: Unknown!");
+    }
+
+    /* This will allow the decoder to accept another frame */
+    decoder.readyForNextFrame();
+  }
+}
@@ -0,0 +1,69 @@
+/*----------------------------------------------------------------------------------
+ * Example using the Universal IR decoding library with a buffering decoder that
+ * lends frames out of a small pool.
+ *
+ * Each frame is borrowed as an ir_frame_view_t, which is just a pointer to the
+ * captured segments plus their count, so the same frame can be decoded and
+ * then logged without copying it. Frames that don't decode are kept back (the
+ * pool carries on capturing into its other slots) and dumped when the serial
+ * port has time for it.
+ */
+#include <BTHI_IR_Decoder.h>
+
+/* Three slots of 72 segments. Samsung frames are 67 edges long. */
+IR_PooledBufferingStreamDecoder<3, 72> decoder;
+
+/* A frame that didn't decode, held until it has been printed */
+ir_frame_view_t g_bad_frame;
+uint8_t g_have_bad_frame = 0;
+
+void setup() {
+  Serial.begin(115200);
+  Serial.println("\n--- BTHI Pooled Samsung Decoding Example ---\n");
+
+  /* Use Pin 8 (the input capture pin on the UNO) */
+  IR_InputCaptureInterface.setup(&decoder, 8, IR_POLARITY_AUTO);
+}
+
+/**
+ * Prints a frame the way IR_BufferingStreamDecoder::debugPrintFrame() does.
+ */
+void printFrame(const ir_frame_view_t *frame) {
+  Serial.print("Segment Count: ");
+  Serial.println(frame->count);
+  for (uint8_t i = 0; i < frame->count; i++) {
+    Serial.print(i);
+    Serial.print(": ");
+    Serial.println(frame->segments[i].duration);
+  }
+}
+
+void loop() {
+  ir_frame_view_t frame;
+  uint32_t data;
+  int8_t res;
+
+  if (decoder.borrowFrame(&frame)) {
+    res = decodeFrameSamsung(&frame, &data);
+    if (res == IR_E_OK) {
+      Serial.print("Received: 0x");
+      Serial.println(data, HEX);
+    } else if (res == IR_E_REPEAT) {
+      Serial.println("Repeat (key held)");
+    }
+
+    if ((res < IR_E_OK) && !g_have_bad_frame) {
+      /* Keep it; it goes back to the pool once it's been printed */
+      g_bad_frame = frame;
+      g_have_bad_frame = 1;
+    } else {
+      decoder.returnFrame(&frame);
+    }
+  } else if (g_have_bad_frame) {
+    /* Nothing else to do, so dump the frame we kept */
+    Serial.println("Didn't decode:");
+    printFrame(&g_bad_frame);
+    decoder.returnFrame(&g_bad_frame);
+    g_have_bad_frame = 0;
+  }
+}
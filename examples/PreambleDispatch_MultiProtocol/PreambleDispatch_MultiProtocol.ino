@@ -0,0 +1,101 @@
+/*----------------------------------------------------------------------------------
+ * Example using the Universal IR decoding library to decode several protocols,
+ * including one of your own, with an IR_PreambleDispatcher.
+ *
+ * Instead of trying every decoder on every frame like decodeFrameAny(), the
+ * dispatcher looks up the frame's header mark and space in a small table and
+ * only runs the decoders whose header fits, so adding more protocols doesn't
+ * slow down the ones you already have.
+ *
+ * The JVC timings below are only an example of registering a protocol the
+ * library doesn't know; JVC repeats the frame without its header, which shows
+ * up here as an invalid start of frame.
+ */
+#include <BTHI_IR_Decoder.h>
+
+struct JvcProtocol {
+  static const uint16_t header_mark_us = 8400;
+  static const uint16_t header_space_us = 4200;
+  static const uint16_t header_tolerance_us = 200;
+  static const uint16_t bit_mark_us = 525;
+  static const uint16_t zero_space_us = 525;
+  static const uint16_t one_space_us = 1575;
+  static const uint16_t bit_tolerance_us = 100;
+  static const uint8_t num_bits = 16;
+  static const uint16_t trailer_mark_us = 525;
+  static const uint16_t repeat_mark_us = 0;   // No repeat frames
+  static const uint16_t repeat_space_us = 0;
+};
+
+#define PROTOCOL_JVC  IR_PROTOCOL_USER
+
+IR_BufferingStreamDecoder decoder;
+IR_PreambleDispatcher<8> dispatcher;
+
+/* Room for 80 segments.  Samsung and Apple frames are 67 edges long. */
+#define NUM_SEGMENTS  80
+
+ir_segment_t g_segment_buffer[NUM_SEGMENTS];
+
+ir_decode_result_t g_result;
+
+void setup() {
+  Serial.begin(115200);
+  Serial.println("\n--- BTHI Preamble Dispatch Example ---\n");
+
+  /* Where Samsung and Apple repeat frames look alike, the first one added
+   * wins. */
+  dispatcher.addPulseDistance<IR_ProtocolSamsung>(IR_PROTOCOL_SAMSUNG);
+  dispatcher.addPulseDistance<IR_ProtocolApple>(IR_PROTOCOL_APPLE);
+  dispatcher.addPulseDistance<JvcProtocol>(PROTOCOL_JVC);
+
+  decoder.setSegmentBuffer(g_segment_buffer, NUM_SEGMENTS);
+
+  /* Use Pin 8 (the input capture pin on the UNO) */
+  IR_InputCaptureInterface.setup(&decoder, 8, IR_POLARITY_AUTO);
+}
+
+void loop() {
+  int8_t res;
+
+  if (decoder.isFrameAvailable()) {
+    res = dispatcher.decode(&decoder, &g_result, millis());
+
+    if (res >= IR_E_OK) {
+      Serial.print(g_result.timestamp);
+      Serial.print("ms ");
+      switch (g_result.protocol) {
+        case IR_PROTOCOL_SAMSUNG:
+          Serial.print("Samsung");
+          break;
+        case IR_PROTOCOL_APPLE:
+          Serial.print("Apple");
+          break;
+        case PROTOCOL_JVC:
+          Serial.print("JVC");
+          break;
+        default:
+          Serial.print("Unknown");
+          break;
+      }
+      Serial.print(" 0x");
+      Serial.print(irGetResultData(&g_result), HEX);
+      if (g_result.flags & IR_RESULT_F_REPEAT) {
+        Serial.print(" repeat");
+      }
+      Serial.print(" quality ");
+      Serial.println(g_result.quality);
+    } else if (res == IR_E_INVALID_START_OF_FRAME) {
+      Serial.println("ERROR: Not a protocol we know!");
+    } else if (res == IR_E_INVALID_END_OF_FRAME) {
+      Serial.println("ERROR: Invalid end of frame!");
+    } else if (res == IR_E_SHORT_FRAME) {
+      Serial.println("ERROR: Short frame!");
+    } else {
+      Serial.println("ERROR: Unknown!");
+    }
+
+    /* This will allow the decoder to accept another frame */
+    decoder.readyForNextFrame();
+  }
+}
@@ -0,0 +1,76 @@
+/*----------------------------------------------------------------------------------
+ * Example using the Universal IR decoding library with a queued buffering decoder
+ * that understands the Samsung IR protocol.
+ *
+ * Up to NUM_FRAMES frames are held while loop() is busy, so holding a button
+ * down doesn't lose repeats just because printing is slow. The delay() in loop()
+ * is there to show that off. If frames still arrive faster than they can be
+ * processed, the number of dropped frames is reported.
+ */
+#include <BTHI_IR_Decoder.h>
+
+IR_QueuedBufferingStreamDecoder decoder;
+
+/* Room for 4 frames of 72 segments. Samsung frames are 67 edges long. */
+#define NUM_FRAMES            4
+#define SEGMENTS_PER_FRAME    72
+
+ir_segment_t g_segment_buffer[NUM_FRAMES * SEGMENTS_PER_FRAME];
+ir_frame_info_t g_frame_info[NUM_FRAMES];
+
+uint8_t g_last_dropped = 0;
+
+void setup() {
+  Serial.begin(115200);
+  Serial.println("\n--- BTHI Queued Samsung Decoding Example ---\n");
+
+  /* Set up the decoder first. Give it room for several frames */
+  decoder.setFrameBuffer(g_segment_buffer, SEGMENTS_PER_FRAME,
+    g_frame_info, NUM_FRAMES);
+
+  /* Use Pin 8 (the input capture pin on the UNO). Samsung repeats are only
+   * about 40ms apart, so end each frame after 10ms of quiet rather than
+   * waiting for the ~32ms timer overflow. */
+  IR_InputCaptureInterface.setup(&decoder, 8, IR_POLARITY_AUTO, 10000);
+}
+
+void loop() {
+  uint32_t data;
+  int8_t res;
+  uint8_t dropped;
+
+  if (decoder.isFrameAvailable()) {
+    Serial.print("[");
+    Serial.print(decoder.getQueuedFrameCount());
+    Serial.print(" queued] ");
+
+    res = decodeFrameSamsung(&decoder, &data);
+    if (res == IR_E_OK) {
+      Serial.print("Received: 0x");
+      Serial.println(data, HEX);
+    } else if (res == IR_E_REPEAT) {
+      Serial.println("Repeat (key held)");
+    } else if (res == IR_E_INVALID_START_OF_FRAME) {
+      Serial.println("ERROR: Invalid start of frame!");
+    } else if (res == IR_E_INVALID_END_OF_FRAME) {
+      Serial.println("ERROR: Invalid end of frame!");
+    } else if (res == IR_E_SHORT_FRAME) {
+      Serial.println("ERROR: Short frame!");
+    } else {
+      Serial.println("ERROR: Unknown!");
+    }
+
+    /* Hand the slot back so the ISR can reuse it */
+    decoder.readyForNextFrame();
+
+    /* Pretend we have something slow to do with the result */
+    delay(100);
+  }
+
+  dropped = decoder.getDroppedFrameCount();
+  if (dropped != g_last_dropped) {
+    Serial.print("Dropped frames so far: ");
+    Serial.println(dropped);
+    g_last_dropped = dropped;
+  }
+}
@@ -0,0 +1,53 @@
+/*----------------------------------------------------------------------------------
+ * Streaming Decode Example using the BTHI Universal IR decoding library.
+ *
+ * This example decodes both Samsung and Apple remotes without buffering the
+ * frame. The IR_StreamDispatcher feeds every segment to one small state machine
+ * per protocol and drops each machine as soon as it can tell the frame isn't
+ * meant for it.
+ */
+#include <BTHI_IR_Decoder.h>
+
+IR_PulseDistanceStreamMachine<IR_ProtocolSamsung> samsung;
+IR_PulseDistanceStreamMachine<IR_ProtocolApple> apple;
+
+IR_StreamMachine *g_machines[] = { &samsung, &apple };
+
+IR_StreamDispatcher dispatcher;
+
+void setup() {
+  Serial.begin(115200);
+  Serial.println("\n--- BTHI Multi-Protocol Streaming Decode Example ---\n");
+
+  dispatcher.setMachines(g_machines, sizeof(g_machines) / sizeof(g_machines[0]));
+
+  // Use Pin 8 (the input capture pin on the UNO)
+  IR_InputCaptureInterface.setup(&dispatcher, 8, IR_POLARITY_AUTO);
+}
+
+void loop() {
+  IR_StreamMachine *machine;
+
+  if (dispatcher.isFrameAvailable()) {
+    machine = dispatcher.getMatchedMachine();
+
+    if (machine == &samsung) {
+      Serial.print("Samsung: 0x");
+    } else if (machine == &apple) {
+      Serial.print("Apple: 0x");
+    }
+    // The dispatcher's getData() also covers repeat frames, which arrive
+    // after only four edges while a key is held
+    Serial.print(dispatcher.getData(), HEX);
+    if (dispatcher.isRepeatFrame()) {
+      Serial.print(" (repeat)");
+    }
+    Serial.println();
+
+    Serial.print("Unmatched frames so far: ");
+    Serial.println(dispatcher.getUnmatchedFrameCount());
+
+    // This will allow the dispatcher to accept another frame
+    dispatcher.readyForNextFrame();
+  }
+}
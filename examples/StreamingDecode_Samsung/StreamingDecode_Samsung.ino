@@ -12,7 +12,14 @@
  *
  * This implementation uses a state machine to track where we are in the frame
  * and uses otherwise similar approach to the IR_BufferingStreamDecoder when
- * it comes to making the frame available to the application.
+ * it comes to making the frame available to the application. One difference
+ * is that it knows exactly how long a Samsung frame is, so it makes the frame
+ * available as soon as the trailing mark arrives instead of waiting ~32ms
+ * for the end-of-frame timeout.
+ *
+ * While a key is held, the remote sends a short repeat frame instead of the
+ * whole code again. It's only three segments long, so it's reported (see
+ * isRepeat()) as soon as its fourth edge arrives, with the code it repeats.
  */
 class SamsungStreamingDecoder : 
 public IR_StreamDecoder {
@@ -21,16 +28,26 @@ private:
     WAITING_FOR_FIRST_EDGE,
     WAITING_FOR_SOF_1,
     WAITING_FOR_SOF_2,
+    WAITING_FOR_REPEAT_SPACE,
+    WAITING_FOR_REPEAT_MARK,
     WAITING_FOR_BIT_TOP,
     WAITING_FOR_BIT_BOTTOM,
+    WAITING_FOR_TRAILER,
     WAITING_FOR_FRAME_TO_END
   };
 
+  /* Tick windows for the Samsung segments, computed at compile time from
+   * IR_ProtocolSamsung so that the ISR only does integer compares.
+   */
+  typedef IR_PulseDistanceWindows<IR_ProtocolSamsung> Windows;
+
   enum decode_state_tag _state;
   uint32_t _receive_data;
   uint8_t _bits_decoded;
   uint8_t _malformed_frame_count;
   uint8_t _frame_available;
+  uint8_t _repeat;
+  uint8_t _have_code;
 
   /**
    * Increments the count of frames that are malformed. Saturates at 255.
@@ -48,11 +65,14 @@ private:
     _state = WAITING_FOR_FIRST_EDGE;
     _bits_decoded = 0;
     _frame_available = 0;
+    _repeat = 0;
   }
 
 public:
   SamsungStreamingDecoder(void) {
     _malformed_frame_count = 0;
+    _have_code = 0;
+    _receive_data = 0;
     resetState();
   }
 
@@ -71,14 +91,19 @@ public:
        * full segment,
        */
       _state = WAITING_FOR_SOF_1;
-      _receive_data = 0;
       break;
 
     case WAITING_FOR_SOF_1:
-      /* Looking for the first 4.5ms segment */
-      if (IR_DURATION_MATCH_US(duration, 4500, 200)) {
+      /* Looking for the first 4.5ms segment, or the 9ms start of a repeat
+       * frame. _receive_data still holds the last code, which is what a
+       * repeat frame repeats, so it isn't cleared until the bits start.
+       */
+      if (Windows::HeaderMark::match(duration)) {
         _state = WAITING_FOR_SOF_2;
       } 
+      else if (Windows::RepeatMark::match(duration)) {
+        _state = WAITING_FOR_REPEAT_SPACE;
+      }
       else {
         recordFrameError();
         _state = WAITING_FOR_FIRST_EDGE;
@@ -87,8 +112,10 @@ public:
 
     case WAITING_FOR_SOF_2:
       /* Looking for the second 4.5ms segment */
-      if (IR_DURATION_MATCH_US(duration, 4500, 200)) {
+      if (Windows::HeaderSpace::match(duration)) {
         _state = WAITING_FOR_BIT_TOP;
+        _receive_data = 0;
+        _have_code = 0;
       } 
       else {
         recordFrameError();
@@ -96,9 +123,35 @@ public:
       }
       break;
 
+    case WAITING_FOR_REPEAT_SPACE:
+      /* A repeat frame's 2.25ms space */
+      if (Windows::RepeatSpace::match(duration)) {
+        _state = WAITING_FOR_REPEAT_MARK;
+      }
+      else {
+        recordFrameError();
+        _state = WAITING_FOR_FIRST_EDGE;
+      }
+      break;
+
+    case WAITING_FOR_REPEAT_MARK:
+      /* The single bit mark that ends a repeat frame. There's nothing to
+       * repeat if we never got a whole code.
+       */
+      if (Windows::BitMark::match(duration) && (0 != _have_code)) {
+        _state = WAITING_FOR_FRAME_TO_END;
+        _repeat = 1;
+        _frame_available = 1;
+      }
+      else {
+        recordFrameError();
+        _state = WAITING_FOR_FIRST_EDGE;
+      }
+      break;
+
     case WAITING_FOR_BIT_TOP:
       /* The top half of a bit is always about 560us */
-      if (IR_DURATION_MATCH_US(duration, 560, 100)) {
+      if (Windows::BitMark::match(duration)) {
         _state = WAITING_FOR_BIT_BOTTOM;
       } 
       else {
@@ -110,7 +163,7 @@ public:
     case WAITING_FOR_BIT_BOTTOM:
       /* The bottom half of a bit determines whether it's a 1 or a
        				 * 0.  If it's about 560us, then it's a 0. Otherwise a 1. */
-      if (IR_DURATION_MATCH_US(duration, 560, 100)) {
+      if (Windows::ZeroSpace::match(duration)) {
         _receive_data <<= 1;
       } 
       else {
@@ -120,9 +173,9 @@ public:
 
       _bits_decoded++;
 
-      if (32 == _bits_decoded) {
-        /* Time to stop decoding */
-        _state = WAITING_FOR_FRAME_TO_END;
+      if (IR_ProtocolSamsung::num_bits == _bits_decoded) {
+        /* Only the trailing mark is left */
+        _state = WAITING_FOR_TRAILER;
       } 
       else {
         /* Go back to waiting for the next bit */
@@ -130,6 +183,20 @@ public:
       }
       break;
 
+    case WAITING_FOR_TRAILER:
+      /* The frame is complete once the trailing mark is seen. Hand it to
+       * the application right away. */
+      if (Windows::TrailerMark::match(duration)) {
+        _state = WAITING_FOR_FRAME_TO_END;
+        _have_code = 1;
+        _frame_available = 1;
+      } 
+      else {
+        recordFrameError();
+        _state = WAITING_FOR_FIRST_EDGE;
+      }
+      break;
+
     case WAITING_FOR_FRAME_TO_END:
       /* Ignore the segment */
       break;
@@ -140,18 +207,15 @@ public:
    * This is called after the hardware layer thinks there is no more frame.
    */
   void endOfFrameEvent(void) {
-    uint8_t frame_ok;
-
-    /* Reset the state machine and record that the frame is complete */
-    if (_state == WAITING_FOR_FRAME_TO_END) {
-      frame_ok = 1;
-    } 
-    else {
-      frame_ok = 0;
+    /* A complete frame was already made available when its trailer arrived.
+     * Leave it alone until readyForNextFrame().
+     */
+    if (0 != _frame_available) {
+      return;
     }
 
+    /* Otherwise whatever we got wasn't a whole frame. Start over. */
     resetState();
-    _frame_available = frame_ok;
   }
 
   uint8_t isFrameAvailable(void) {
@@ -167,6 +231,14 @@ public:
   uint32_t getReceiveData(void) {
     return _receive_data;
   }
+
+  /**
+   * Non-zero if the frame was a repeat frame, meaning the key behind
+   * getReceiveData() is still held.
+   */
+  uint8_t isRepeat(void) {
+    return _repeat;
+  }
 };
 
 SamsungStreamingDecoder decoder;
@@ -184,7 +256,7 @@ void loop() {
   
   if (decoder.isFrameAvailable()) {
     data = decoder.getReceiveData();
-    Serial.print("Received: ");
+    Serial.print(decoder.isRepeat() ? "Repeated: " : "Received: ");
     Serial.print(codeToString(data));
     Serial.print(" (0x");
     Serial.print(data, HEX);
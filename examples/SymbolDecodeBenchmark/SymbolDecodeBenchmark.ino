@@ -0,0 +1,177 @@
+/*----------------------------------------------------------------------------------
+ * Benchmark for the symbol stream bit decoder of the BTHI Universal IR
+ * decoding library.
+ *
+ * Measures how many CPU cycles it takes to turn the 32 bits of a packed
+ * Samsung symbol frame (see IR_SymbolStreamDecoder) into a number with:
+ *   - a loop that reads one symbol and shifts in one bit at a time
+ *     (reproduced below as decodeOneAtATime so that we can compare)
+ *   - irDecodeSymbolBits(), which looks bits up two at a time in a table in
+ *     flash
+ *
+ * Also decodes a whole frame both ways with decodeFrameSamsung() to check
+ * they agree. Timer 1 is run at the full 16 MHz clock (no prescaler) so TCNT1
+ * counts CPU cycles directly. Don't call IR_InputCaptureInterface.setup() in
+ * this sketch; it would reconfigure the timer underneath us.
+ *
+ * Results are printed once on the serial port at 115200 baud.
+ *
+ * This sketch hasn't been run on a board yet, so there are no AVR figures
+ * to compare against. irDecodeSymbolBits() was only timed on the host
+ * (extras/trace, "ir_trace_tool symbols"), and whether the table in flash
+ * pays off as well on the AVR is unverified until someone runs this.
+ */
+#include <BTHI_IR_Decoder.h>
+
+#define NUM_ITERATIONS  64
+
+/* Samsung Vol+ (0xE0E0E01F) as it comes out of IR_SymbolStreamDecoder */
+const uint16_t g_frame[] = {
+  9067, 8818, 1252, 3273, 1208, 3273, 1208, 3272, 1207, 1025, 1207, 1025,
+  1207, 1024, 1207, 1016, 1207, 1025, 1207, 3273, 1208, 3272, 1209, 3273,
+  1208, 1025, 1207, 1025, 1208, 1024, 1208, 1024, 1206, 1025, 1207, 3273,
+  1208, 3272, 1208, 3273, 1209, 1024, 1208, 1025, 1207, 1025, 1207, 1023,
+  1208, 1024, 1207, 1025, 1207, 1025, 1208, 1025, 1208, 3272, 1208, 3273,
+  1207, 3272, 1208, 3273, 1207, 3273, 1208
+};
+
+#define FRAME_SEGMENTS  (sizeof(g_frame) / sizeof(g_frame[0]))
+
+const ir_symbol_thresholds_t g_thresholds =
+  IR_SYMBOL_THRESHOLDS(IR_ProtocolSamsung);
+
+uint8_t g_symbols[IR_SYMBOL_BYTES(FRAME_SEGMENTS)];
+
+/* volatile so the compiler can't throw the results away */
+volatile uint32_t g_sink;
+
+/**
+ * The bit loop decodeFrameSymbols() used before irDecodeSymbolBits().
+ */
+uint32_t decodeOneAtATime(const uint8_t *symbols, uint8_t num_bits) {
+  uint32_t datagram = 0;
+
+  for (uint8_t i = 3; i < 2 + (2 * num_bits); i += 2) {
+    datagram <<= 1;
+    if (IR_SYMBOL_SHORT != irGetSymbol(symbols, i)) {
+      datagram |= 1;
+    }
+  }
+
+  return datagram;
+}
+
+/**
+ * Starts Timer 1 counting CPU cycles from zero.
+ */
+void startCycleCounter(void) {
+  TCCR1A = 0;
+  TCCR1B = 0;
+  TIMSK1 = 0;
+  TCNT1 = 0;
+  TCCR1B = (1 << CS10);
+}
+
+/**
+ * Stops Timer 1 and returns the number of cycles since startCycleCounter().
+ */
+uint16_t stopCycleCounter(void) {
+  TCCR1B = 0;
+  return TCNT1;
+}
+
+uint16_t benchEmpty(void) {
+  uint16_t cycles;
+
+  startCycleCounter();
+  g_sink = g_symbols[0];
+  cycles = stopCycleCounter();
+
+  return cycles;
+}
+
+uint16_t benchOneAtATime(void) {
+  uint16_t cycles;
+
+  startCycleCounter();
+  g_sink = decodeOneAtATime(g_symbols, 32);
+  cycles = stopCycleCounter();
+
+  return cycles;
+}
+
+uint16_t benchTable(void) {
+  uint16_t cycles;
+
+  startCycleCounter();
+  g_sink = irDecodeSymbolBits(g_symbols, 32);
+  cycles = stopCycleCounter();
+
+  return cycles;
+}
+
+/**
+ * Runs one of the bench functions NUM_ITERATIONS times, flipping a bit of
+ * the payload each time, and prints the worst and average cycle counts, less
+ * the cost of an empty measurement.
+ */
+void report(const char *name, uint16_t (*bench)(void), uint16_t overhead) {
+  uint32_t total = 0;
+  uint16_t worst = 0;
+  uint16_t cycles;
+
+  for (uint16_t i = 0; i < NUM_ITERATIONS; i++) {
+    g_symbols[1 + (i % 15)] ^= 0x04;
+
+    /* Keep the serial ISR from landing in the middle of a measurement */
+    noInterrupts();
+    cycles = bench() - overhead;
+    interrupts();
+
+    total += cycles;
+    if (cycles > worst) {
+      worst = cycles;
+    }
+  }
+
+  Serial.print(name);
+  Serial.print(": avg ");
+  Serial.print(total / NUM_ITERATIONS);
+  Serial.print(" cycles, worst ");
+  Serial.print(worst);
+  Serial.println(" cycles");
+}
+
+void setup() {
+  IR_SymbolStreamDecoder<FRAME_SEGMENTS> decoder(&g_thresholds);
+  uint16_t overhead;
+  uint32_t data = 0;
+
+  Serial.begin(115200);
+  Serial.println("\n--- BTHI Symbol Decode Benchmark ---\n");
+
+  /* Feed the frame through the decoder the way the ISR would */
+  decoder.edgeEvent(0);
+  for (uint8_t i = 0; i < FRAME_SEGMENTS; i++) {
+    decoder.edgeEvent(g_frame[i]);
+  }
+  decoder.endOfFrameEvent();
+  memcpy(g_symbols, decoder.getSymbolBuffer(), sizeof(g_symbols));
+
+  Serial.print("decodeFrameSamsung: ");
+  Serial.print(decodeFrameSamsung(&decoder, &data));
+  Serial.print(" 0x");
+  Serial.print(data, HEX);
+  Serial.print(", one at a time: 0x");
+  Serial.println(decodeOneAtATime(g_symbols, 32), HEX);
+
+  noInterrupts();
+  overhead = benchEmpty();
+  interrupts();
+
+  report("one bit at a time     ", benchOneAtATime, overhead);
+  report("irDecodeSymbolBits    ", benchTable, overhead);
+}
+
+void loop() {
+}
@@ -0,0 +1,55 @@
+/*----------------------------------------------------------------------------------
+ * Example using the Universal IR decoding library with a decoder that stores
+ * each segment as a 2-bit symbol (short, long or header) instead of its
+ * duration.
+ *
+ * The segments are classified against a threshold table as they arrive, so a
+ * Samsung frame takes 21 bytes instead of the 134 BufferedDecode_Samsung
+ * needs, and decoding it is a handful of symbol compares.
+ */
+#include <BTHI_IR_Decoder.h>
+
+/* Short, long and header boundaries worked out from the protocol */
+const ir_symbol_thresholds_t g_thresholds =
+  IR_SYMBOL_THRESHOLDS(IR_ProtocolSamsung);
+
+/* Room for 72 segments. Samsung frames are 67 edges long. */
+IR_SymbolStreamDecoder<72> decoder(&g_thresholds);
+
+void setup() {
+  Serial.begin(115200);
+  Serial.println("\n--- BTHI Symbol Stream Samsung Decoding Example ---\n");
+
+  /* Hand the frame over as soon as the trailing mark arrives */
+  decoder.setFrameLength(
+    IR_PulseDistanceWindows<IR_ProtocolSamsung>::frame_segments);
+
+  /* Use Pin 8 (the input capture pin on the UNO) */
+  IR_InputCaptureInterface.setup(&decoder, 8, IR_POLARITY_AUTO);
+}
+
+void loop() {
+  uint32_t data;
+  int8_t res;
+
+  if (decoder.isFrameAvailable()) {
+    res = decodeFrameSamsung(&decoder, &data);
+    if (res == IR_E_OK) {
+      Serial.print("Received: 0x");
+      Serial.println(data, HEX);
+    } else if (res == IR_E_REPEAT) {
+      Serial.println("Repeat (key held)");
+    } else if (res == IR_E_INVALID_START_OF_FRAME) {
+      Serial.println("ERROR: Invalid start of frame!");
+    } else if (res == IR_E_INVALID_END_OF_FRAME) {
+      Serial.println("ERROR: Invalid end of frame!");
+    } else if (res == IR_E_SHORT_FRAME) {
+      Serial.println("ERROR: Short frame!");
+    } else {
+      Serial.println("ERROR: Unknown!");
+    }
+
+    /* This will allow the decoder to accept another frame */
+    decoder.readyForNextFrame();
+  }
+}
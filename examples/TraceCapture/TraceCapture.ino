@@ -0,0 +1,80 @@
+/*----------------------------------------------------------------------------------
+ * Trace Capture Example using the BTHI Universal IR decoding library.
+ *
+ * Records every frame it sees to the serial port in the binary trace format
+ * described in extras/trace/ir_trace.h, so that captures from the field can be
+ * kept and replayed into the decoders on a regular computer. Save the output
+ * on the computer with something like:
+ *
+ *   stty -F /dev/ttyACM0 115200 raw && cat /dev/ttyACM0 > capture.irt
+ *
+ * Opening the port resets the board, so the file always starts with the
+ * header. Check it with "ir_trace_tool info capture.irt" (see
+ * extras/trace/ir_trace_tool.cpp). Nothing else may be printed on the serial
+ * port while capturing, or the file will be corrupted.
+ */
+#include <BTHI_IR_Decoder.h>
+
+/* Describes the capture in the trace header. Change it to say which remote
+ * and button you're recording. */
+#define TRACE_SOURCE          "TraceCapture sketch"
+
+/* Format constants from extras/trace/ir_trace.h */
+#define TRACE_VERSION         1
+
+IR_QueuedBufferingStreamDecoder decoder;
+
+/* Room for 4 frames of 128 segments, more than any protocol we know of */
+#define NUM_FRAMES            4
+#define SEGMENTS_PER_FRAME    128
+
+ir_segment_t g_segment_buffer[NUM_FRAMES * SEGMENTS_PER_FRAME];
+ir_frame_info_t g_frame_info[NUM_FRAMES];
+
+void write16(uint16_t value) {
+  Serial.write((uint8_t)value);
+  Serial.write((uint8_t)(value >> 8));
+}
+
+void write32(uint32_t value) {
+  write16((uint16_t)value);
+  write16((uint16_t)(value >> 16));
+}
+
+void writeHeader(void) {
+  Serial.write((const uint8_t *)"BTIR", 4);
+  Serial.write((uint8_t)TRACE_VERSION);
+  Serial.write((uint8_t)0);                   /* flags: no timestamps */
+  Serial.write((uint8_t)IR_POLARITY_AUTO);
+  Serial.write((uint8_t)(sizeof(TRACE_SOURCE) - 1));
+  write32(IR_TICK_PERIOD_NS);
+  Serial.write((const uint8_t *)TRACE_SOURCE, sizeof(TRACE_SOURCE) - 1);
+}
+
+void setup() {
+  Serial.begin(115200);
+  writeHeader();
+
+  decoder.setFrameBuffer(g_segment_buffer, SEGMENTS_PER_FRAME,
+    g_frame_info, NUM_FRAMES);
+
+  /* Use Pin 8 (the input capture pin on the UNO) */
+  IR_InputCaptureInterface.setup(&decoder, 8, IR_POLARITY_AUTO);
+}
+
+void loop() {
+  ir_segment_t *segments;
+  uint8_t count;
+
+  if (decoder.isFrameAvailable()) {
+    segments = decoder.getSegmentBuffer();
+    count = decoder.getSegmentCount();
+
+    write16(count);
+    for (uint8_t i = 0; i < count; i++) {
+      write16(segments[i].duration);
+    }
+
+    decoder.readyForNextFrame();
+  }
+}
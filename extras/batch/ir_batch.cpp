@@ -0,0 +1,390 @@
+/*---------------------------------------------------------------------------
+ * Streaming Infrared Decoder Library - multithreaded batch decoding
+ *
+ * Copyright (c) 2013, Bryan Thomas (BTHI) and Christopher Myers
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *---------------------------------------------------------------------------
+ *
+ * Implementation of IR_BatchDecoder. See ir_batch.h.
+ */
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <ir_batch.h>
+
+/* Frames per chunk unless setChunkSize() says otherwise. Big enough that
+ * taking a chunk off a queue is noise next to decoding it, small enough that
+ * there are plenty to steal.
+ */
+#define IR_BATCH_DEFAULT_CHUNK  4096
+
+/* Longest frame loadTrace() accepts */
+#define IR_BATCH_MAX_SEGMENTS   1024
+
+/* Frames a pulse distance protocol collects before their bits are classified
+ * in one go. Enough to keep the kernels busy, few enough that the segments
+ * are still in cache from checking the headers.
+ */
+#define IR_BATCH_SIMD_BLOCK     64
+
+/**
+ * One worker's queue of chunk numbers. The owner takes from the front and
+ * thieves take from the back, so they only meet on the last chunk.
+ */
+struct ir_batch_queue_t {
+    std::mutex lock;
+    std::deque<size_t> chunks;
+
+    bool popFront(size_t *chunk) {
+        std::lock_guard<std::mutex> guard(lock);
+        if (chunks.empty()) {
+            return false;
+        }
+        *chunk = chunks.front();
+        chunks.pop_front();
+        return true;
+    }
+
+    bool popBack(size_t *chunk) {
+        std::lock_guard<std::mutex> guard(lock);
+        if (chunks.empty()) {
+            return false;
+        }
+        *chunk = chunks.back();
+        chunks.pop_back();
+        return true;
+    }
+};
+
+/**
+ * Frames a pulse distance protocol has accepted but whose bits haven't been
+ * classified yet.
+ */
+struct ir_batch_block_t {
+    uint32_t frames[IR_BATCH_SIMD_BLOCK];
+    uint32_t bit_offsets[IR_BATCH_SIMD_BLOCK];
+    size_t count;
+};
+
+IR_BatchDecoder::IR_BatchDecoder(void) {
+    _chunk_frames = IR_BATCH_DEFAULT_CHUNK;
+    _simd_level = irSimdDetect();
+}
+
+void IR_BatchDecoder::addProtocol(const char *name, ir_batch_decode_t decode,
+        ir_batch_check_t check, uint8_t num_bits, uint16_t zero_lo,
+        uint16_t zero_hi) {
+    protocol_t protocol = { name, decode, check, num_bits, zero_lo, zero_hi };
+
+    _protocols.push_back(protocol);
+}
+
+/**
+ * Adds a protocol to try on every frame. Protocols are tried in the order
+ * they're registered.
+ *
+ * Parameters:
+ *      name: What to call it in results. Not copied.
+ *      decode: The decode function, for example
+ *          decodeFramePulseDistance<IR_ProtocolSamsung>.
+ *
+ * Return: Nothing
+ */
+void IR_BatchDecoder::registerProtocol(const char *name,
+        ir_batch_decode_t decode) {
+    addProtocol(name, decode, NULL, 0, 0, 0);
+}
+
+/**
+ * Return: The name the protocol was registered with, or "none" for -1.
+ */
+const char *IR_BatchDecoder::getProtocolName(int8_t protocol) {
+    if ((protocol < 0) || ((size_t)protocol >= _protocols.size())) {
+        return "none";
+    }
+    return _protocols[protocol].name;
+}
+
+/**
+ * Appends a copy of one frame to the corpus.
+ *
+ * Parameters:
+ *      segments: The segment durations, in Timer 1 ticks.
+ *      count: The number of segments.
+ *
+ * Return: Nothing
+ */
+void IR_BatchDecoder::addFrame(const ir_segment_t *segments, uint16_t count) {
+    _frame_offsets.push_back((uint32_t)_segments.size());
+    _frame_counts.push_back(count);
+    _segments.insert(_segments.end(), segments, segments + count);
+}
+
+/**
+ * Appends every frame of a trace file to the corpus, converting durations
+ * to Timer 1 ticks if the trace used a different tick period.
+ *
+ * Parameters:
+ *      path: The trace file.
+ *
+ * Return: IR_E_OK, or the irTraceReadHeader()/irTraceReadFrame() error that
+ *      stopped it. Frames read before an error are kept.
+ */
+int8_t IR_BatchDecoder::loadTrace(const char *path) {
+    static ir_segment_t segments[IR_BATCH_MAX_SEGMENTS];
+    ir_trace_header_t header;
+    uint64_t ticks;
+    uint16_t count;
+    int8_t res;
+    FILE *file;
+
+    file = fopen(path, "rb");
+    if (NULL == file) {
+        return IR_TRACE_E_IO;
+    }
+
+    res = irTraceReadHeader(file, &header);
+    while (IR_E_OK == res) {
+        res = irTraceReadFrame(file, &header, NULL, segments,
+            IR_BATCH_MAX_SEGMENTS, &count);
+        if (IR_E_OK != res) {
+            break;
+        }
+
+        if (IR_TICK_PERIOD_NS != header.tick_period_ns) {
+            for (uint16_t i = 0; i < count; i++) {
+                ticks = ((uint64_t)segments[i].duration
+                    * header.tick_period_ns + IR_TICK_PERIOD_NS / 2)
+                    / IR_TICK_PERIOD_NS;
+                segments[i].duration =
+                    (ticks > 0xFFFF) ? 0xFFFF : (uint16_t)ticks;
+            }
+        }
+
+        addFrame(segments, count);
+    }
+
+    fclose(file);
+    return (IR_TRACE_E_END == res) ? IR_E_OK : res;
+}
+
+void IR_BatchDecoder::clearFrames(void) {
+    _segments.clear();
+    _frame_offsets.clear();
+    _frame_counts.clear();
+    _results.clear();
+}
+
+size_t IR_BatchDecoder::getFrameCount(void) {
+    return _frame_counts.size();
+}
+
+/**
+ * Sets how many frames make up one unit of work. Mostly useful for
+ * benchmarking; the default suits corpora from thousands of frames up.
+ */
+void IR_BatchDecoder::setChunkSize(uint32_t frames) {
+    _chunk_frames = (0 == frames) ? 1 : frames;
+}
+
+/**
+ * Picks the classification kernel used by decode(). The constructor picks
+ * the fastest one the CPU supports, so this is only needed to compare them;
+ * don't pick one the CPU can't run.
+ */
+void IR_BatchDecoder::setSimdLevel(ir_simd_level_t level) {
+    _simd_level = level;
+}
+
+ir_simd_level_t IR_BatchDecoder::getSimdLevel(void) {
+    return _simd_level;
+}
+
+/**
+ * Classifies the bits of a block of accepted frames and writes their data.
+ */
+void IR_BatchDecoder::flushBlock(const protocol_t *protocol,
+        ir_batch_block_t *block) {
+    uint32_t data[IR_BATCH_SIMD_BLOCK];
+
+    irSimdClassifyFrames(_simd_level, _segments.data(), block->bit_offsets,
+        block->count, protocol->num_bits, protocol->zero_lo,
+        protocol->zero_hi, data);
+
+    for (size_t i = 0; i < block->count; i++) {
+        _results[block->frames[i]].data = data[i];
+    }
+    block->count = 0;
+}
+
+/**
+ * Decodes frames [first, last) into their result slots.
+ */
+void IR_BatchDecoder::decodeRange(size_t first, size_t last) {
+    const protocol_t *protocols = _protocols.data();
+    size_t num_protocols = _protocols.size();
+    std::vector<ir_batch_block_t> blocks(num_protocols);
+    const ir_segment_t *segments;
+    ir_batch_result_t *result;
+    ir_batch_block_t *block;
+    uint16_t count;
+    int8_t res;
+
+    for (size_t p = 0; p < num_protocols; p++) {
+        blocks[p].count = 0;
+    }
+
+    for (size_t f = first; f < last; f++) {
+        result = &_results[f];
+        segments = &_segments[_frame_offsets[f]];
+        count = _frame_counts[f];
+
+        result->protocol = -1;
+        result->error = IR_E_SHORT_FRAME;
+        result->data = 0;
+
+        if (count > 0xFF) {
+            result->error = IR_TRACE_E_FRAME_TOO_LONG;
+            continue;
+        }
+
+        for (size_t p = 0; p < num_protocols; p++) {
+            if (NULL == protocols[p].check) {
+                res = protocols[p].decode(segments, (uint8_t)count,
+                    &result->data);
+            } else {
+                res = protocols[p].check(segments, (uint8_t)count);
+                if (IR_E_OK == res) {
+                    /* The bits follow the header mark and space */
+                    block = &blocks[p];
+                    block->frames[block->count] = (uint32_t)f;
+                    block->bit_offsets[block->count] = _frame_offsets[f] + 2;
+                    if (IR_BATCH_SIMD_BLOCK == ++block->count) {
+                        flushBlock(&protocols[p], block);
+                    }
+                }
+            }
+
+            if ((IR_E_OK == res) || (IR_E_REPEAT == res)) {
+                result->protocol = (int8_t)p;
+                result->error = res;
+                break;
+            }
+
+            if ((0 == p) || (IR_E_INVALID_END_OF_FRAME == res)) {
+                result->error = res;
+            }
+        }
+
+        if (IR_E_OK != result->error) {
+            result->data = 0;
+        }
+    }
+
+    for (size_t p = 0; p < num_protocols; p++) {
+        if (0 != blocks[p].count) {
+            flushBlock(&protocols[p], &blocks[p]);
+        }
+    }
+}
+
+/**
+ * Decodes the whole corpus. Results from any previous decode() are
+ * replaced. More threads only help as far as the machine has cores to run
+ * them, and the speedup hasn't been measured (see ir_batch.h).
+ *
+ * Parameters:
+ *      threads: How many worker threads to use. 0 means one per core.
+ *
+ * Return: Nothing
+ */
+void IR_BatchDecoder::decode(unsigned threads) {
+    size_t num_frames = _frame_counts.size();
+    size_t num_chunks = (num_frames + _chunk_frames - 1) / _chunk_frames;
+    std::vector<std::thread> workers;
+
+    _results.resize(num_frames);
+
+    if (0 == threads) {
+        threads = std::thread::hardware_concurrency();
+        if (0 == threads) {
+            threads = 1;
+        }
+    }
+    if (threads > num_chunks) {
+        threads = (0 == num_chunks) ? 1 : (unsigned)num_chunks;
+    }
+
+    if (1 == threads) {
+        decodeRange(0, num_frames);
+        return;
+    }
+
+    /* Deal the chunks out in contiguous runs, so each worker starts on its
+     * own stretch of memory.
+     */
+    std::vector<ir_batch_queue_t> queues(threads);
+    for (unsigned w = 0; w < threads; w++) {
+        for (size_t c = num_chunks * w / threads;
+                c < num_chunks * (w + 1) / threads; c++) {
+            queues[w].chunks.push_back(c);
+        }
+    }
+
+    for (unsigned w = 0; w < threads; w++) {
+        workers.push_back(std::thread([this, &queues, w, threads,
+                num_frames]() {
+            size_t chunk;
+            size_t first;
+            size_t last;
+
+            for (;;) {
+                bool found = queues[w].popFront(&chunk);
+
+                /* Out of our own work; take some from the back of someone
+                 * else's queue.
+                 */
+                for (unsigned v = 1; !found && (v < threads); v++) {
+                    found = queues[(w + v) % threads].popBack(&chunk);
+                }
+                if (!found) {
+                    return;
+                }
+
+                first = chunk * _chunk_frames;
+                last = first + _chunk_frames;
+                if (last > num_frames) {
+                    last = num_frames;
+                }
+                decodeRange(first, last);
+            }
+        }));
+    }
+
+    for (unsigned w = 0; w < threads; w++) {
+        workers[w].join();
+    }
+}
+
+/**
+ * Return: The result for a frame, numbered in the order frames were added.
+ *      Only valid after decode().
+ */
+const ir_batch_result_t *IR_BatchDecoder::getResult(size_t frame) {
+    return &_results[frame];
+}
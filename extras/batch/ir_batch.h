@@ -0,0 +1,129 @@
+/*---------------------------------------------------------------------------
+ * Streaming Infrared Decoder Library - multithreaded batch decoding
+ *
+ * Copyright (c) 2013, Bryan Thomas (BTHI) and Christopher Myers
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *---------------------------------------------------------------------------
+ *
+ * Decodes large corpora of recorded frames (see extras/trace) on a regular
+ * computer, using every core. Frames are loaded into one flat array, cut into
+ * chunks, and the chunks are shared out between worker threads. Each worker
+ * keeps a queue of its own chunks and steals from the back of the others'
+ * queues once it runs out, so a worker that gets a slow stretch of the
+ * corpus doesn't hold everyone else up. Results are written straight into
+ * their frame's slot, so they come out in input order with no merging.
+ *
+ * How well this scales with the number of cores hasn't been measured; so
+ * far it has only been run on a single core machine, where the results
+ * were checked to be the same whatever the thread count. Use
+ * "ir_batch_tool --scale" to find out on yours.
+ *
+ * Every registered protocol is tried on every frame, in the order they were
+ * registered, until one accepts it. Pulse distance protocols only check the
+ * header and trailer frame by frame; the bits of the frames they accept are
+ * collected into blocks and classified by the vectorised kernels in
+ * ir_simd.h, using the fastest one the CPU supports.
+ *
+ * See ir_batch_tool.cpp for how to build against this.
+ */
+#ifndef IR_BATCH_H
+#define IR_BATCH_H
+
+#include <vector>
+#include <ir_trace.h>
+#include <ir_simd.h>
+
+/* The signature of decodeFramePulseDistance<Protocol>() */
+typedef int8_t (*ir_batch_decode_t)(const ir_segment_t *segments,
+		uint8_t count, uint32_t *data);
+
+/* The signature of checkFramePulseDistance<Protocol>() */
+typedef int8_t (*ir_batch_check_t)(const ir_segment_t *segments,
+		uint16_t count);
+
+/* What one frame decoded to. protocol is the index of the protocol that
+ * accepted it, or -1 if none did. In that case error says why: the error
+ * from a protocol that recognised the start of the frame if there was one
+ * (IR_E_INVALID_END_OF_FRAME), otherwise from the first protocol tried.
+ * Frames longer than the decoders can take get IR_TRACE_E_FRAME_TOO_LONG.
+ * Repeat frames get the protocol that recognised them, IR_E_REPEAT and no
+ * data.
+ */
+typedef struct {
+	int8_t protocol;
+	int8_t error;
+	uint32_t data;
+} ir_batch_result_t;
+
+struct ir_batch_block_t;
+
+class IR_BatchDecoder {
+private:
+	struct protocol_t {
+		const char *name;
+		ir_batch_decode_t decode;
+
+		/* Pulse distance protocols only; check is NULL for the others */
+		ir_batch_check_t check;
+		uint8_t num_bits;
+		uint16_t zero_lo;
+		uint16_t zero_hi;
+	};
+
+	std::vector<protocol_t> _protocols;
+	std::vector<ir_segment_t> _segments;
+	std::vector<uint32_t> _frame_offsets;
+	std::vector<uint16_t> _frame_counts;
+	std::vector<ir_batch_result_t> _results;
+	uint32_t _chunk_frames;
+	ir_simd_level_t _simd_level;
+
+	void decodeRange(size_t first, size_t last);
+	void flushBlock(const protocol_t *protocol, ir_batch_block_t *block);
+	void addProtocol(const char *name, ir_batch_decode_t decode,
+		ir_batch_check_t check, uint8_t num_bits, uint16_t zero_lo,
+		uint16_t zero_hi);
+
+public:
+	IR_BatchDecoder(void);
+
+	void registerProtocol(const char *name, ir_batch_decode_t decode);
+	template<class Protocol>
+	void registerPulseDistance(const char *name) {
+		typedef IR_PulseDistanceWindows<Protocol> Windows;
+
+		addProtocol(name, decodeFramePulseDistance<Protocol>,
+			checkFramePulseDistance<Protocol>,
+			IR_FixedNumBits<Protocol>::value,
+			Windows::ZeroSpace::lo, Windows::ZeroSpace::hi);
+	}
+	const char *getProtocolName(int8_t protocol);
+
+	void addFrame(const ir_segment_t *segments, uint16_t count);
+	int8_t loadTrace(const char *path);
+	void clearFrames(void);
+	size_t getFrameCount(void);
+
+	void setChunkSize(uint32_t frames);
+	void setSimdLevel(ir_simd_level_t level);
+	ir_simd_level_t getSimdLevel(void);
+	void decode(unsigned threads);
+	const ir_batch_result_t *getResult(size_t frame);
+};
+
+#endif
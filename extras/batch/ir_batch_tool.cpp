@@ -0,0 +1,309 @@
+/*---------------------------------------------------------------------------
+ * Streaming Infrared Decoder Library - batch decoding tool
+ *
+ * Copyright (c) 2013, Bryan Thomas (BTHI) and Christopher Myers
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *---------------------------------------------------------------------------
+ *
+ * Decodes trace files (see extras/trace) with every protocol the library
+ * knows, using IR_BatchDecoder. Build it from the library directory:
+ *
+ *  g++ -O2 -pthread -I. -Iextras/trace -Iextras/batch \
+ *      extras/batch/ir_batch_tool.cpp extras/batch/ir_batch.cpp \
+ *      extras/batch/ir_simd.cpp extras/trace/ir_trace.cpp \
+ *      BTHI_IR_Decoder.cpp BTHI_IR_Hal_Host.cpp -o ir_batch_tool
+ *
+ * Usage:
+ *
+ *  ir_batch_tool [-j THREADS] [--simd scalar|sse2|avx2] [--summary] TRACE...
+ *      Prints one line per frame, in the order they appear in the traces:
+ *      the frame number, the protocol and either the data or the error.
+ *      With --summary, only the totals for each protocol are printed.
+ *      --simd picks the bit classification kernel instead of the fastest
+ *      one the CPU supports; the output must be the same whichever is used.
+ *
+ *  ir_batch_tool --scale [--repeat N] TRACE...
+ *      Loads the traces N times over (default 100000) and reports how fast
+ *      they decode on 1 thread with each kernel the CPU supports, then with
+ *      1, 2, 4... threads up to one per core, and the speedup over 1 thread.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <thread>
+#include <ir_batch.h>
+
+/* How many times the timed decode is repeated; the best is reported */
+#define TOOL_SCALE_RUNS     5
+
+static int usage(void) {
+    fprintf(stderr,
+        "usage: ir_batch_tool [-j THREADS] [--simd scalar|sse2|avx2] "
+        "[--summary] TRACE...\n"
+        "       ir_batch_tool --scale [--repeat N] TRACE...\n");
+    return 2;
+}
+
+static uint64_t nowNs(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static const char *errorString(int8_t res) {
+    switch (res) {
+    case IR_E_SHORT_FRAME:
+        return "short frame";
+    case IR_E_INVALID_START_OF_FRAME:
+        return "invalid start of frame";
+    case IR_E_INVALID_END_OF_FRAME:
+        return "invalid end of frame";
+    case IR_TRACE_E_FRAME_TOO_LONG:
+        return "frame too long";
+    }
+    return "unknown error";
+}
+
+/**
+ * Return: Non-zero if name is a kernel this CPU can run, in which case
+ *      *level is set to it.
+ */
+static int parseSimdLevel(const char *name, ir_simd_level_t *level) {
+    for (int l = IR_SIMD_SCALAR; l <= irSimdDetect(); l++) {
+        if (0 == strcmp(name, irSimdName((ir_simd_level_t)l))) {
+            *level = (ir_simd_level_t)l;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Return: The fastest frames per second out of TOOL_SCALE_RUNS decodes.
+ */
+static double timeDecode(IR_BatchDecoder *batch, unsigned threads) {
+    uint64_t best = ~0ULL;
+    uint64_t start;
+    uint64_t elapsed;
+
+    for (int run = 0; run < TOOL_SCALE_RUNS; run++) {
+        start = nowNs();
+        batch->decode(threads);
+        elapsed = nowNs() - start;
+        if (elapsed < best) {
+            best = elapsed;
+        }
+    }
+
+    return batch->getFrameCount() * 1e9 / best;
+}
+
+static void registerProtocols(IR_BatchDecoder *batch) {
+    batch->registerPulseDistance<IR_ProtocolSamsung>("Samsung");
+    batch->registerPulseDistance<IR_ProtocolApple>("Apple");
+}
+
+static int commandDecode(char **paths, int num_paths, unsigned threads,
+        ir_simd_level_t simd_level, uint8_t summary) {
+    IR_BatchDecoder batch;
+    const ir_batch_result_t *result;
+    unsigned long totals[3] = { 0, 0, 0 };
+    unsigned long repeats = 0;
+
+    registerProtocols(&batch);
+    batch.setSimdLevel(simd_level);
+    for (int i = 0; i < num_paths; i++) {
+        if (IR_E_OK != batch.loadTrace(paths[i])) {
+            fprintf(stderr, "%s: failed to load\n", paths[i]);
+            return 1;
+        }
+    }
+
+    batch.decode(threads);
+
+    for (size_t f = 0; f < batch.getFrameCount(); f++) {
+        result = batch.getResult(f);
+        if (IR_E_REPEAT == result->error) {
+            repeats++;
+        } else {
+            totals[result->protocol + 1]++;
+        }
+
+        if (0 != summary) {
+            continue;
+        }
+        if (IR_E_OK == result->error) {
+            printf("%lu %s 0x%08lX\n", (unsigned long)f,
+                batch.getProtocolName(result->protocol),
+                (unsigned long)result->data);
+        } else if (IR_E_REPEAT == result->error) {
+            printf("%lu %s repeat\n", (unsigned long)f,
+                batch.getProtocolName(result->protocol));
+        } else {
+            printf("%lu none %s\n", (unsigned long)f,
+                errorString(result->error));
+        }
+    }
+
+    if (0 != summary) {
+        printf("Samsung: %lu\nApple: %lu\nrepeat: %lu\nnone: %lu\n",
+            totals[1], totals[2], repeats, totals[0]);
+    }
+    return 0;
+}
+
+/**
+ * Reads every frame of the traces into one flat list, so they can be added
+ * to the corpus many times over without going back to the disk.
+ *
+ * Return: Non-zero if they all loaded.
+ */
+static int readFrames(char **paths, int num_paths,
+        std::vector<ir_segment_t> *segments, std::vector<uint16_t> *counts) {
+    static ir_segment_t frame[1024];
+    ir_trace_header_t header;
+    uint16_t count;
+    int8_t res;
+    FILE *file;
+
+    for (int i = 0; i < num_paths; i++) {
+        file = fopen(paths[i], "rb");
+        if (NULL == file) {
+            perror(paths[i]);
+            return 0;
+        }
+
+        res = irTraceReadHeader(file, &header);
+        while (IR_E_OK == res) {
+            res = irTraceReadFrame(file, &header, NULL, frame, 1024, &count);
+            if (IR_E_OK == res) {
+                segments->insert(segments->end(), frame, frame + count);
+                counts->push_back(count);
+            }
+        }
+        fclose(file);
+
+        if (IR_TRACE_E_END != res) {
+            fprintf(stderr, "%s: failed to load (%d)\n", paths[i], res);
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+static int commandScale(char **paths, int num_paths, unsigned long repeat) {
+    IR_BatchDecoder batch;
+    std::vector<ir_segment_t> segments;
+    std::vector<uint16_t> counts;
+    unsigned cores = std::thread::hardware_concurrency();
+    ir_simd_level_t best_level = irSimdDetect();
+    double base_rate = 0.0;
+    double rate;
+    size_t offset;
+
+    if (0 == readFrames(paths, num_paths, &segments, &counts)) {
+        return 1;
+    }
+
+    registerProtocols(&batch);
+    for (unsigned long r = 0; r < repeat; r++) {
+        offset = 0;
+        for (size_t f = 0; f < counts.size(); f++) {
+            batch.addFrame(&segments[offset], counts[f]);
+            offset += counts[f];
+        }
+    }
+
+    if (0 == cores) {
+        cores = 1;
+    }
+
+    printf("%lu frames\n", (unsigned long)batch.getFrameCount());
+    printf("%-8s %14s %8s\n", "kernel", "frames/s", "speedup");
+
+    for (int l = IR_SIMD_SCALAR; l <= best_level; l++) {
+        batch.setSimdLevel((ir_simd_level_t)l);
+        rate = timeDecode(&batch, 1);
+        if (IR_SIMD_SCALAR == l) {
+            base_rate = rate;
+        }
+        printf("%-8s %14.0f %8.2f\n", irSimdName((ir_simd_level_t)l), rate,
+            rate / base_rate);
+    }
+
+    batch.setSimdLevel(best_level);
+    printf("\n%-8s %14s %8s\n", "threads", "frames/s", "speedup");
+
+    for (unsigned threads = 1; ; threads *= 2) {
+        if (threads > cores) {
+            threads = cores;
+        }
+
+        rate = timeDecode(&batch, threads);
+        if (1 == threads) {
+            base_rate = rate;
+        }
+        printf("%-8u %14.0f %8.2f\n", threads, rate, rate / base_rate);
+
+        if (threads >= cores) {
+            break;
+        }
+    }
+
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    unsigned threads = 0;
+    unsigned long repeat = 100000;
+    ir_simd_level_t simd_level = irSimdDetect();
+    uint8_t summary = 0;
+    uint8_t scale = 0;
+    int i;
+
+    for (i = 1; i < argc; i++) {
+        if ((0 == strcmp(argv[i], "-j")) && (i + 1 < argc)) {
+            threads = (unsigned)atoi(argv[++i]);
+        } else if ((0 == strcmp(argv[i], "--repeat")) && (i + 1 < argc)) {
+            repeat = strtoul(argv[++i], NULL, 10);
+        } else if ((0 == strcmp(argv[i], "--simd")) && (i + 1 < argc)) {
+            if (0 == parseSimdLevel(argv[++i], &simd_level)) {
+                fprintf(stderr, "%s: not supported here\n", argv[i]);
+                return 2;
+            }
+        } else if (0 == strcmp(argv[i], "--summary")) {
+            summary = 1;
+        } else if (0 == strcmp(argv[i], "--scale")) {
+            scale = 1;
+        } else {
+            break;
+        }
+    }
+
+    if (i >= argc) {
+        return usage();
+    }
+
+    if (0 != scale) {
+        return commandScale(argv + i, argc - i, repeat);
+    }
+    return commandDecode(argv + i, argc - i, threads, simd_level, summary);
+}
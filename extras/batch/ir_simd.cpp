@@ -0,0 +1,206 @@
+/*---------------------------------------------------------------------------
+ * Streaming Infrared Decoder Library - vectorised bit classification
+ *
+ * Copyright (c) 2013, Bryan Thomas (BTHI) and Christopher Myers
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *---------------------------------------------------------------------------
+ *
+ * Implementation of the classification kernels. See ir_simd.h.
+ *
+ * The AVX2 kernel is compiled with a target attribute rather than -mavx2, so
+ * the program still runs on machines without it; irSimdDetect() decides at
+ * runtime whether it can be used.
+ */
+#include <ir_simd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define IR_SIMD_X86
+#include <immintrin.h>
+#endif
+
+/**
+ * Return: x with its bits in the opposite order.
+ */
+static inline uint32_t reverseBits(uint32_t x) {
+    x = ((x >> 1) & 0x55555555UL) | ((x & 0x55555555UL) << 1);
+    x = ((x >> 2) & 0x33333333UL) | ((x & 0x33333333UL) << 2);
+    x = ((x >> 4) & 0x0F0F0F0FUL) | ((x & 0x0F0F0F0FUL) << 4);
+    x = ((x >> 8) & 0x00FF00FFUL) | ((x & 0x00FF00FFUL) << 8);
+    return (x >> 16) | (x << 16);
+}
+
+/**
+ * Classifies bits [first, num_bits) one at a time. Bit i of the result is
+ * set if bit i's space is not a zero.
+ */
+static inline uint32_t classifyScalar(const ir_segment_t *bits, uint8_t first,
+        uint8_t num_bits, uint16_t zero_lo, uint16_t zero_hi) {
+    uint32_t mask = 0;
+    uint16_t space;
+
+    for (uint8_t i = first; i < num_bits; i++) {
+        space = bits[(2 * i) + 1].duration;
+        if ((space < zero_lo) || (space > zero_hi)) {
+            mask |= (1UL << i);
+        }
+    }
+
+    return mask;
+}
+
+/**
+ * Turns a mask from the classifiers into the datagram.
+ */
+static inline uint32_t toDatagram(uint32_t mask, uint8_t num_bits) {
+    return (0 == num_bits) ? 0 : reverseBits(mask) >> (32 - num_bits);
+}
+
+static void classifyFramesScalar(const ir_segment_t *segments,
+        const uint32_t *bit_offsets, size_t num_frames, uint8_t num_bits,
+        uint16_t zero_lo, uint16_t zero_hi, uint32_t *data) {
+    for (size_t f = 0; f < num_frames; f++) {
+        data[f] = toDatagram(classifyScalar(segments + bit_offsets[f], 0,
+            num_bits, zero_lo, zero_hi), num_bits);
+    }
+}
+
+#if defined(IR_SIMD_X86)
+static void classifyFramesSse2(const ir_segment_t *segments,
+        const uint32_t *bit_offsets, size_t num_frames, uint8_t num_bits,
+        uint16_t zero_lo, uint16_t zero_hi, uint32_t *data) {
+    const __m128i lo = _mm_set1_epi32(zero_lo);
+    const __m128i hi = _mm_set1_epi32(zero_hi);
+    uint8_t vector_bits = num_bits & ~3;
+    const ir_segment_t *bits;
+    __m128i spaces;
+    __m128i outside;
+    uint32_t mask;
+
+    for (size_t f = 0; f < num_frames; f++) {
+        bits = segments + bit_offsets[f];
+        mask = 0;
+
+        for (uint8_t i = 0; i < vector_bits; i += 4) {
+            spaces = _mm_srli_epi32(
+                _mm_loadu_si128((const __m128i *)(bits + (2 * i))), 16);
+            outside = _mm_or_si128(_mm_cmplt_epi32(spaces, lo),
+                _mm_cmpgt_epi32(spaces, hi));
+            mask |= (uint32_t)_mm_movemask_ps(_mm_castsi128_ps(outside)) << i;
+        }
+
+        mask |= classifyScalar(bits, vector_bits, num_bits, zero_lo, zero_hi);
+        data[f] = toDatagram(mask, num_bits);
+    }
+}
+
+__attribute__((target("avx2")))
+static void classifyFramesAvx2(const ir_segment_t *segments,
+        const uint32_t *bit_offsets, size_t num_frames, uint8_t num_bits,
+        uint16_t zero_lo, uint16_t zero_hi, uint32_t *data) {
+    const __m256i lo = _mm256_set1_epi32(zero_lo);
+    const __m256i hi = _mm256_set1_epi32(zero_hi);
+    uint8_t vector_bits = num_bits & ~7;
+    const ir_segment_t *bits;
+    __m256i spaces;
+    __m256i outside;
+    uint32_t mask;
+
+    for (size_t f = 0; f < num_frames; f++) {
+        bits = segments + bit_offsets[f];
+        mask = 0;
+
+        for (uint8_t i = 0; i < vector_bits; i += 8) {
+            spaces = _mm256_srli_epi32(
+                _mm256_loadu_si256((const __m256i *)(bits + (2 * i))), 16);
+            outside = _mm256_or_si256(_mm256_cmpgt_epi32(lo, spaces),
+                _mm256_cmpgt_epi32(spaces, hi));
+            mask |= (uint32_t)_mm256_movemask_ps(
+                _mm256_castsi256_ps(outside)) << i;
+        }
+
+        mask |= classifyScalar(bits, vector_bits, num_bits, zero_lo, zero_hi);
+        data[f] = toDatagram(mask, num_bits);
+    }
+}
+#endif
+
+/**
+ * Return: The fastest kernel this CPU can run.
+ */
+ir_simd_level_t irSimdDetect(void) {
+#if defined(IR_SIMD_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return IR_SIMD_AVX2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return IR_SIMD_SSE2;
+    }
+#endif
+    return IR_SIMD_SCALAR;
+}
+
+const char *irSimdName(ir_simd_level_t level) {
+    switch (level) {
+    case IR_SIMD_SSE2:
+        return "sse2";
+    case IR_SIMD_AVX2:
+        return "avx2";
+    default:
+        return "scalar";
+    }
+}
+
+/**
+ * Classifies the bits of many frames and packs them into datagrams, the
+ * same way decodeFramePulseDistance() does once the header and trailer have
+ * been checked.
+ *
+ * Parameters:
+ *      level: Which kernel to use. Must be one irSimdDetect() allows (or
+ *          lower); anything this build doesn't have falls back to scalar.
+ *      segments: The array all the frames are in.
+ *      bit_offsets: For each frame, the index in segments of its first bit
+ *          mark (the segment after the header space).
+ *      num_frames: How many frames.
+ *      num_bits: Bits per frame, up to 32. Each frame needs 2 * num_bits
+ *          segments from its bit offset.
+ *      zero_lo: Shortest space that's a zero, in ticks.
+ *      zero_hi: Longest space that's a zero, in ticks.
+ *      data: Gets the datagram for each frame.
+ *
+ * Return: Nothing
+ */
+void irSimdClassifyFrames(ir_simd_level_t level,
+        const ir_segment_t *segments, const uint32_t *bit_offsets,
+        size_t num_frames, uint8_t num_bits, uint16_t zero_lo,
+        uint16_t zero_hi, uint32_t *data) {
+#if defined(IR_SIMD_X86)
+    if (IR_SIMD_AVX2 == level) {
+        classifyFramesAvx2(segments, bit_offsets, num_frames, num_bits,
+            zero_lo, zero_hi, data);
+        return;
+    } else if (IR_SIMD_SSE2 == level) {
+        classifyFramesSse2(segments, bit_offsets, num_frames, num_bits,
+            zero_lo, zero_hi, data);
+        return;
+    }
+#endif
+    classifyFramesScalar(segments, bit_offsets, num_frames, num_bits,
+        zero_lo, zero_hi, data);
+}
@@ -0,0 +1,51 @@
+/*---------------------------------------------------------------------------
+ * Streaming Infrared Decoder Library - vectorised bit classification
+ *
+ * Copyright (c) 2013, Bryan Thomas (BTHI) and Christopher Myers
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *---------------------------------------------------------------------------
+ *
+ * The inner loop of decodeFramePulseDistance() for many frames at once, with
+ * SSE2 and AVX2 versions for x86 and a plain one for everything else.
+ *
+ * The bits of a pulse distance frame are (mark, space) pairs of 16-bit
+ * durations. Loaded as 32-bit lanes, each lane is one bit with the space in
+ * the top half, so a shift, two compares and a movemask classify 4 (SSE2) or
+ * 8 (AVX2) bits at a time, already in order. Reversing the mask gives the
+ * datagram, first bit most significant, exactly as the scalar loop builds it.
+ */
+#ifndef IR_SIMD_H
+#define IR_SIMD_H
+
+#include <BTHI_IR_Decoder.h>
+
+typedef enum {
+	IR_SIMD_SCALAR = 0,
+	IR_SIMD_SSE2,
+	IR_SIMD_AVX2
+} ir_simd_level_t;
+
+extern ir_simd_level_t irSimdDetect(void);
+extern const char *irSimdName(ir_simd_level_t level);
+
+extern void irSimdClassifyFrames(ir_simd_level_t level,
+		const ir_segment_t *segments, const uint32_t *bit_offsets,
+		size_t num_frames, uint8_t num_bits, uint16_t zero_lo,
+		uint16_t zero_hi, uint32_t *data);
+
+#endif
@@ -0,0 +1,610 @@
+/*---------------------------------------------------------------------------
+ * Streaming Infrared Decoder Library - host benchmark suite
+ *
+ * Copyright (c) 2013, Bryan Thomas (BTHI) and Christopher Myers
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *---------------------------------------------------------------------------
+ *
+ * Replays recorded and synthetic frames through the decoders using the host
+ * backend (see BTHI_IR_Hal_Host.cpp) and reports how fast each one is and
+ * how much RAM it needs. Build and run it from the library directory:
+ *
+ *  g++ -O2 -I. extras/benchmark/ir_benchmark.cpp BTHI_IR_Decoder.cpp \
+ *      BTHI_IR_Hal_Host.cpp -lpthread -o ir_benchmark
+ *  ./ir_benchmark
+ *
+ * Every benchmark runs a fixed amount of work several times and reports the
+ * fastest run, which is the most repeatable number on a busy machine. The
+ * output is one line per benchmark with stable names, so that the results
+ * of two commits can be compared with diff or a spreadsheet:
+ *
+ *  name  ns/edge  ns/frame  ram_bytes  allocations
+ *
+ * followed by a table of key-to-result latencies (see benchLatency()).
+ *
+ * A few benchmarks check the decoder's result first and the exit status is
+ * 1 if any of them got it wrong.
+ *
+ * A '-' means the figure doesn't apply to that benchmark. ram_bytes is the
+ * decoder objects plus their buffers as sized on the host. Pointers are
+ * smaller on the AVR, so the figures there are a bit lower.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <new>
+#include <time.h>
+#include <BTHI_IR_Decoder.h>
+#include <BTHI_IR_DecisionTree.h>
+
+/* How many frames each timed run processes, and how many runs we take the
+ * best of.
+ */
+#define BENCH_FRAMES        20000
+#define BENCH_RUNS          7
+
+/* Largest frame we generate */
+#define BENCH_MAX_SEGMENTS  80
+
+/* Volume up on a Samsung remote, from doc/protocol_info.md */
+static const uint16_t g_recorded_samsung[] = {
+    9067, 8818, 1252, 3273, 1208, 3273, 1208, 3272, 1207, 1025, 1207, 1025,
+    1207, 1024, 1207, 1016, 1207, 1025, 1207, 3273, 1208, 3272, 1209, 3273,
+    1208, 1025, 1207, 1025, 1208, 1024, 1208, 1024, 1206, 1025, 1207, 3273,
+    1208, 3272, 1208, 3273, 1209, 1024, 1208, 1025, 1207, 1025, 1207, 1023,
+    1208, 1024, 1207, 1025, 1207, 1025, 1208, 1025, 1208, 3272, 1208, 3273,
+    1207, 3272, 1208, 3273, 1207, 3273, 1208
+};
+
+typedef struct {
+    const char *name;
+    ir_segment_t segments[BENCH_MAX_SEGMENTS];
+    uint8_t count;
+} bench_frame_t;
+
+/* Counts heap allocations so we can show the decoders don't make any */
+static unsigned long g_allocations;
+
+void *operator new(size_t size) {
+    void *p;
+
+    g_allocations++;
+    p = malloc(size);
+    if (NULL == p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void *p) noexcept {
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+    free(p);
+}
+
+/* Keeps the compiler from optimising away results we don't otherwise use */
+static volatile uint32_t g_sink;
+
+static uint64_t nowNs(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static uint16_t usToTicks(uint16_t us, int16_t jitter_us) {
+    return (uint16_t)IR_US_TO_TICKS(us + jitter_us);
+}
+
+/**
+ * Builds a frame for a pulse distance protocol descriptor, with a little
+ * pseudo-random jitter on every segment like a real receiver would give us.
+ */
+template <class Protocol>
+static void makeFrame(bench_frame_t *frame, const char *name,
+        uint32_t payload, uint32_t seed) {
+    uint8_t n = 0;
+
+    frame->name = name;
+
+    /* +/- 50us of jitter from a tiny LCG */
+#define BENCH_JITTER() \
+    ((int16_t)(((seed = seed * 1103515245UL + 12345UL) >> 16) % 101) - 50)
+
+    frame->segments[n++].duration =
+        usToTicks(Protocol::header_mark_us, BENCH_JITTER());
+    frame->segments[n++].duration =
+        usToTicks(Protocol::header_space_us, BENCH_JITTER());
+
+    for (int8_t bit = Protocol::num_bits - 1; bit >= 0; bit--) {
+        frame->segments[n++].duration =
+            usToTicks(Protocol::bit_mark_us, BENCH_JITTER());
+        frame->segments[n++].duration = usToTicks(
+            ((payload >> bit) & 1) ? Protocol::one_space_us
+                : Protocol::zero_space_us, BENCH_JITTER());
+    }
+
+    if (0 != Protocol::trailer_mark_us) {
+        frame->segments[n++].duration =
+            usToTicks(Protocol::trailer_mark_us, BENCH_JITTER());
+    }
+#undef BENCH_JITTER
+
+    frame->count = n;
+}
+
+static void report(const char *bench, const char *frame, double ns_per_edge,
+        double ns_per_frame, unsigned long ram_bytes,
+        unsigned long allocations) {
+    char name[64];
+
+    snprintf(name, sizeof(name), "%s/%s", bench, frame);
+    printf("%-44s", name);
+    if (ns_per_edge >= 0) {
+        printf(" %9.2f", ns_per_edge);
+    } else {
+        printf(" %9s", "-");
+    }
+    printf(" %10.2f %9lu %11lu\n", ns_per_frame, ram_bytes, allocations);
+}
+
+/**
+ * Times feeding whole frames into a decoder delegate edge by edge, the same
+ * way the capture ISR does it. IR_HwInterface goes through the
+ * IR_StreamDecoder vtable, while IR_StaticHwInterface calls the decoder's
+ * methods directly; static_dispatch picks which one to mimic.
+ *
+ * consume is called after each frame to do whatever the application would
+ * (decode it, release it) and is included in the timing.
+ */
+template <class Decoder, class Consume>
+static void benchDelegate(const char *bench, const bench_frame_t *frame,
+        Decoder *decoder, uint8_t static_dispatch, unsigned long ram_bytes,
+        Consume consume) {
+    /* volatile so that the compiler can't devirtualise the calls for us */
+    IR_StreamDecoder * volatile virtual_decoder = decoder;
+    uint64_t best = ~0ULL;
+    unsigned long allocations = g_allocations;
+
+    for (int run = 0; run < BENCH_RUNS; run++) {
+        uint64_t start = nowNs();
+
+        for (uint32_t f = 0; f < BENCH_FRAMES; f++) {
+            if (0 != static_dispatch) {
+                decoder->Decoder::edgeEvent(0);
+                for (uint8_t i = 0; i < frame->count; i++) {
+                    decoder->Decoder::edgeEvent(frame->segments[i].duration);
+                }
+                decoder->Decoder::endOfFrameEvent();
+            } else {
+                virtual_decoder->edgeEvent(0);
+                for (uint8_t i = 0; i < frame->count; i++) {
+                    virtual_decoder->edgeEvent(frame->segments[i].duration);
+                }
+                virtual_decoder->endOfFrameEvent();
+            }
+            consume();
+        }
+
+        uint64_t elapsed = nowNs() - start;
+        if (elapsed < best) {
+            best = elapsed;
+        }
+    }
+
+    /* One edge per segment plus the leading edge */
+    report(bench, frame->name,
+        (double)best / ((double)BENCH_FRAMES * (frame->count + 1)),
+        (double)best / BENCH_FRAMES, ram_bytes,
+        g_allocations - allocations);
+}
+
+/**
+ * Times a buffered decode function on a frame that's already been captured.
+ */
+static void benchDecode(const char *bench, const bench_frame_t *frame,
+        int8_t (*decode)(IR_BufferingStreamDecoder *, uint32_t *)) {
+    static IR_BufferingStreamDecoder decoder;
+    static ir_segment_t buffer[BENCH_MAX_SEGMENTS];
+    uint64_t best = ~0ULL;
+    unsigned long allocations;
+    uint32_t data = 0;
+
+    decoder.setSegmentBuffer(buffer, BENCH_MAX_SEGMENTS);
+    decoder.edgeEvent(0);
+    for (uint8_t i = 0; i < frame->count; i++) {
+        decoder.edgeEvent(frame->segments[i].duration);
+    }
+    decoder.endOfFrameEvent();
+
+    allocations = g_allocations;
+    for (int run = 0; run < BENCH_RUNS; run++) {
+        uint64_t start = nowNs();
+
+        for (uint32_t f = 0; f < BENCH_FRAMES; f++) {
+            g_sink += decode(&decoder, &data);
+            g_sink += data;
+        }
+
+        uint64_t elapsed = nowNs() - start;
+        if (elapsed < best) {
+            best = elapsed;
+        }
+    }
+
+    report(bench, frame->name, -1, (double)best / BENCH_FRAMES,
+        sizeof(decoder) + sizeof(buffer), g_allocations - allocations);
+}
+
+/**
+ * Times picking the decoder for a frame out of many (see benchProtocols()).
+ * decode is handed the frame and a result to fill in.
+ */
+template <class Decode>
+static void benchPick(const char *bench, const bench_frame_t *frame,
+        unsigned long ram_bytes, Decode decode) {
+    ir_decode_result_t result;
+    uint64_t best = ~0ULL;
+    unsigned long allocations = g_allocations;
+
+    for (int run = 0; run < BENCH_RUNS; run++) {
+        uint64_t start = nowNs();
+
+        for (uint32_t f = 0; f < BENCH_FRAMES; f++) {
+            g_sink += decode(frame->segments, frame->count, &result);
+            g_sink += irGetResultData(&result);
+        }
+
+        uint64_t elapsed = nowNs() - start;
+        if (elapsed < best) {
+            best = elapsed;
+        }
+    }
+
+    report(bench, frame->name, -1, (double)best / BENCH_FRAMES, ram_bytes,
+        g_allocations - allocations);
+}
+
+/* Made-up protocols with Samsung's bits and their own preamble, to see how
+ * picking a decoder scales with how many there are. None of them accepts a
+ * Samsung or Apple frame's preamble.
+ */
+#define BENCH_MAX_PROTOCOLS 30
+
+template <uint8_t K>
+struct BenchProtocol : public IR_ProtocolSamsung {
+    static const uint16_t header_mark_us = 2400 + (700 * K);
+    static const uint16_t header_space_us = 1200 + (150 * K);
+    static const uint16_t repeat_mark_us = 0;
+};
+
+typedef IR_PreambleDispatcher<BENCH_MAX_PROTOCOLS + 1> bench_dispatcher_t;
+
+template <uint8_t K>
+static void addBenchProtocols(uint8_t n, bench_dispatcher_t *dispatcher,
+        ir_result_decoder_t *decoders) {
+    if (K < n) {
+        dispatcher->addPulseDistance<BenchProtocol<K> >(
+            IR_PROTOCOL_USER + K);
+        decoders[K] = decodeResultPulseDistance<BenchProtocol<K>,
+            ir_segment_t>;
+        addBenchProtocols<K + 1>(n, dispatcher, decoders);
+    }
+}
+
+template <>
+void addBenchProtocols<BENCH_MAX_PROTOCOLS>(uint8_t, bench_dispatcher_t *,
+        ir_result_decoder_t *) {
+}
+
+/**
+ * Decodes a Samsung frame with n made-up protocols registered ahead of
+ * Samsung, once by trying each decoder in turn the way decodeFrameAny()
+ * does and once with an IR_PreambleDispatcher. The first grows with n and
+ * the second shouldn't.
+ */
+static void benchProtocols(const bench_frame_t *frame, uint8_t n) {
+    static bench_dispatcher_t dispatcher;
+    static ir_result_decoder_t decoders[BENCH_MAX_PROTOCOLS + 1];
+    static uint8_t num_decoders;
+    char bench[32];
+
+    dispatcher.clear();
+    addBenchProtocols<0>(n, &dispatcher, decoders);
+    dispatcher.addPulseDistance<IR_ProtocolSamsung>(IR_PROTOCOL_SAMSUNG);
+    decoders[n] = decodeResultPulseDistance<IR_ProtocolSamsung, ir_segment_t>;
+    num_decoders = n + 1;
+
+    snprintf(bench, sizeof(bench), "pick_sequential_%u", num_decoders);
+    benchPick(bench, frame, num_decoders * sizeof(ir_result_decoder_t),
+        [&](const ir_segment_t *segments, uint8_t count,
+                ir_decode_result_t *result) -> int8_t {
+            int8_t res = IR_E_INVALID_START_OF_FRAME;
+            int8_t decoder_res;
+
+            for (uint8_t i = 0; i < num_decoders; i++) {
+                decoder_res = decoders[i](segments, count,
+                    IR_PROTOCOL_UNKNOWN + i, result);
+                if (IR_E_OK <= decoder_res) {
+                    return decoder_res;
+                }
+                if (IR_E_INVALID_START_OF_FRAME == res) {
+                    res = decoder_res;
+                }
+            }
+            return res;
+        });
+
+    snprintf(bench, sizeof(bench), "pick_preamble_%u", num_decoders);
+    benchPick(bench, frame, sizeof(dispatcher),
+        [&](const ir_segment_t *segments, uint8_t count,
+                ir_decode_result_t *result) -> int8_t {
+            return dispatcher.decode(segments, count, result);
+        });
+}
+
+/* IR_DecisionTree of the first N made-up protocols, then Samsung. A tree
+ * takes 16 protocols at most.
+ */
+#define BENCH_MAX_TREE_PROTOCOLS 15
+
+template <uint8_t N, class... Protocols>
+struct BenchTree {
+    typedef typename BenchTree<N - 1,
+        IR_TreeProtocol<BenchProtocol<N - 1>, IR_PROTOCOL_USER + N - 1>,
+        Protocols...>::type type;
+};
+
+template <class... Protocols>
+struct BenchTree<0, Protocols...> {
+    typedef IR_DecisionTree<Protocols...,
+        IR_TreeProtocol<IR_ProtocolSamsung, IR_PROTOCOL_SAMSUNG> > type;
+};
+
+/**
+ * benchProtocols() for an IR_DecisionTree, which has no RAM to report.
+ */
+template <uint8_t N>
+static void benchTree(const bench_frame_t *frame) {
+    char bench[32];
+
+    snprintf(bench, sizeof(bench), "pick_tree_%u", N + 1);
+    benchPick(bench, frame, 0,
+        [&](const ir_segment_t *segments, uint8_t count,
+                ir_decode_result_t *result) -> int8_t {
+            return BenchTree<N>::type::decode(segments, count, result);
+        });
+}
+
+/* A 16-bit protocol with Samsung's header, so that Samsung's decoder finds
+ * its frames short and picking a decoder has to carry on past it.
+ */
+struct BenchShortSamsung : public IR_ProtocolSamsung {
+    static const uint8_t num_bits = 16;
+    static const uint16_t repeat_mark_us = 0;
+};
+
+/**
+ * Makes sure decode() gets a frame of BenchShortSamsung right, then times
+ * it. Return: 0, or 1 if it got it wrong.
+ */
+template <class Decode>
+static int benchOverlap(const char *bench, const bench_frame_t *frame,
+        unsigned long ram_bytes, Decode decode) {
+    ir_decode_result_t result;
+    int8_t res = decode(frame->segments, frame->count, &result);
+
+    if ((IR_E_OK != res) || (IR_PROTOCOL_USER != result.protocol)
+            || (0xA5C3UL != irGetResultData(&result))) {
+        fprintf(stderr, "%s/%s: got %d, protocol %u, data 0x%08lX\n",
+            bench, frame->name, res, result.protocol,
+            (unsigned long)irGetResultData(&result));
+        return 1;
+    }
+
+    benchPick(bench, frame, ram_bytes, decode);
+    return 0;
+}
+
+/**
+ * Measures key-to-result latency: the time from the first edge of a frame
+ * until the application could see it with isFrameAvailable(). This is in
+ * simulated time, using the host backend's model of the Timer 1 end-of-frame
+ * timeout, so it's exact and doesn't depend on the build machine.
+ * end_of_frame_us is passed on to IR_HwInterface::setup().
+ */
+template <class Decoder>
+static void benchLatency(const char *bench, const bench_frame_t *frame,
+        Decoder *decoder, uint16_t end_of_frame_us) {
+    static uint32_t now = 0;
+    uint32_t start;
+    uint32_t latency = 0;
+    uint8_t seen = 0;
+
+    IR_InputCaptureInterface.setup(decoder, 8, IR_POLARITY_AUTO,
+        end_of_frame_us);
+
+    /* Leave plenty of quiet time after whatever ran before */
+    now += 0x20000UL;
+    start = now;
+
+    irHostEdge(now);
+    for (uint8_t i = 0; i < frame->count; i++) {
+        now += frame->segments[i].duration;
+        irHostEdge(now);
+        if ((0 == seen) && decoder->isFrameAvailable()) {
+            latency = now - start;
+            seen = 1;
+        }
+    }
+
+    if (0 == seen) {
+        now += (0 == irEndOfFrameTicks(end_of_frame_us)) ?
+            0x10000UL : irEndOfFrameTicks(end_of_frame_us);
+        irHostIdle(now);
+        if (decoder->isFrameAvailable()) {
+            latency = now - start;
+            seen = 1;
+        }
+    }
+
+    if (0 != seen) {
+        printf("%-44s %10.1f\n", bench,
+            (double)latency * IR_TICK_PERIOD_NS / 1000.0);
+    } else {
+        printf("%-44s %10s\n", bench, "no frame");
+    }
+
+    decoder->readyForNextFrame();
+}
+
+int main(void) {
+    static bench_frame_t frames[3];
+    static bench_frame_t overlap;
+    static IR_PreambleDispatcher<2> overlap_dispatcher;
+    typedef IR_DecisionTree<
+        IR_TreeProtocol<IR_ProtocolSamsung, IR_PROTOCOL_SAMSUNG>,
+        IR_TreeProtocol<BenchShortSamsung, IR_PROTOCOL_USER> > overlap_tree;
+    int failures = 0;
+    static IR_BufferingStreamDecoder buffering;
+    static ir_segment_t buffer[BENCH_MAX_SEGMENTS];
+    static IR_PulseDistanceStreamMachine<IR_ProtocolSamsung> samsung;
+    static IR_PulseDistanceStreamMachine<IR_ProtocolApple> apple;
+    static IR_StreamMachine *machines_samsung[] = { &samsung };
+    static IR_StreamMachine *machines_both[] = { &samsung, &apple };
+    static IR_StreamDispatcher dispatcher;
+    static IR_DecisionTreeStreamDecoder<
+        IR_TreeProtocol<IR_ProtocolSamsung, IR_PROTOCOL_SAMSUNG>,
+        IR_TreeProtocol<IR_ProtocolApple, IR_PROTOCOL_APPLE> > tree;
+
+    frames[0].name = "recorded_samsung";
+    frames[0].count = sizeof(g_recorded_samsung) / sizeof(uint16_t);
+    for (uint8_t i = 0; i < frames[0].count; i++) {
+        frames[0].segments[i].duration = g_recorded_samsung[i];
+    }
+    makeFrame<IR_ProtocolSamsung>(&frames[1], "synthetic_samsung",
+        0xE0E0D02FUL, 1);
+    makeFrame<IR_ProtocolApple>(&frames[2], "synthetic_apple",
+        0x77E1508CUL, 2);
+    makeFrame<BenchShortSamsung>(&overlap, "synthetic_short",
+        0xA5C3UL, 3);
+
+    printf("%-44s %9s %10s %9s %11s\n", "name", "ns/edge", "ns/frame",
+        "ram_bytes", "allocations");
+
+    buffering.setSegmentBuffer(buffer, BENCH_MAX_SEGMENTS);
+    for (int i = 0; i < 3; i++) {
+        benchDelegate("buffering_edgeEvent", &frames[i], &buffering, 0,
+            sizeof(buffering) + sizeof(buffer),
+            [&]() { buffering.readyForNextFrame(); });
+    }
+
+    for (int i = 0; i < 3; i++) {
+        benchDelegate("buffering_edgeEvent_static", &frames[i], &buffering, 1,
+            sizeof(buffering) + sizeof(buffer),
+            [&]() { buffering.readyForNextFrame(); });
+    }
+
+    benchDecode("decodeFrameSamsung", &frames[0], decodeFrameSamsung);
+    benchDecode("decodeFrameSamsung", &frames[1], decodeFrameSamsung);
+    benchDecode("decodeFrameApple", &frames[2], decodeFrameApple);
+
+    dispatcher.setMachines(machines_samsung, 1);
+    for (int i = 0; i < 2; i++) {
+        benchDelegate("streaming_samsung", &frames[i], &dispatcher, 0,
+            sizeof(dispatcher) + sizeof(samsung) + sizeof(machines_samsung),
+            [&]() {
+                g_sink += dispatcher.getMatchedMachine()->getData();
+                dispatcher.readyForNextFrame();
+            });
+    }
+
+    for (int i = 0; i < 2; i++) {
+        benchDelegate("streaming_samsung_static", &frames[i], &dispatcher, 1,
+            sizeof(dispatcher) + sizeof(samsung) + sizeof(machines_samsung),
+            [&]() {
+                g_sink += dispatcher.getMatchedMachine()->getData();
+                dispatcher.readyForNextFrame();
+            });
+    }
+
+    dispatcher.setMachines(machines_both, 2);
+    for (int i = 0; i < 3; i++) {
+        benchDelegate("streaming_samsung_apple", &frames[i], &dispatcher, 0,
+            sizeof(dispatcher) + sizeof(samsung) + sizeof(apple)
+                + sizeof(machines_both),
+            [&]() {
+                g_sink += dispatcher.getMatchedMachine()->getData();
+                dispatcher.readyForNextFrame();
+            });
+    }
+
+    benchProtocols(&frames[1], 0);
+    benchProtocols(&frames[1], 7);
+    benchProtocols(&frames[1], 15);
+    benchProtocols(&frames[1], BENCH_MAX_PROTOCOLS);
+    benchTree<0>(&frames[1]);
+    benchTree<7>(&frames[1]);
+    benchTree<BENCH_MAX_TREE_PROTOCOLS>(&frames[1]);
+
+    overlap_dispatcher.addPulseDistance<IR_ProtocolSamsung>(
+        IR_PROTOCOL_SAMSUNG);
+    overlap_dispatcher.addPulseDistance<BenchShortSamsung>(IR_PROTOCOL_USER);
+    failures += benchOverlap("pick_preamble_overlap", &overlap,
+        sizeof(overlap_dispatcher),
+        [&](const ir_segment_t *segments, uint8_t count,
+                ir_decode_result_t *result) -> int8_t {
+            return overlap_dispatcher.decode(segments, count, result);
+        });
+    failures += benchOverlap("pick_tree_overlap", &overlap, 0,
+        [&](const ir_segment_t *segments, uint8_t count,
+                ir_decode_result_t *result) -> int8_t {
+            return overlap_tree::decode(segments, count, result);
+        });
+
+    for (int i = 0; i < 3; i++) {
+        benchDelegate("tree_samsung_apple_static", &frames[i], &tree, 1,
+            sizeof(tree),
+            [&]() {
+                g_sink += tree.getData();
+                tree.readyForNextFrame();
+            });
+    }
+
+    printf("\n%-44s %10s\n", "latency", "us");
+
+    buffering.setFrameLength(0);
+    benchLatency("buffering_timeout/recorded_samsung", &frames[0],
+        &buffering, 0);
+    benchLatency("buffering_gap_10ms/recorded_samsung", &frames[0],
+        &buffering, 10000);
+    buffering.setFrameLength(
+        IR_PulseDistanceWindows<IR_ProtocolSamsung>::frame_segments);
+    benchLatency("buffering_frame_length/recorded_samsung", &frames[0],
+        &buffering, 0);
+    buffering.setFrameLength(0);
+
+    dispatcher.setMachines(machines_both, 2);
+    benchLatency("streaming_samsung_apple/recorded_samsung", &frames[0],
+        &dispatcher, 0);
+    benchLatency("streaming_samsung_apple/synthetic_apple", &frames[2],
+        &dispatcher, 0);
+
+    return (0 == failures) ? 0 : 1;
+}
@@ -0,0 +1,174 @@
+/*---------------------------------------------------------------------------
+ * Streaming Infrared Decoder Library - capture latency simulation
+ *
+ * Copyright (c) 2013, Bryan Thomas (BTHI) and Christopher Myers
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *---------------------------------------------------------------------------
+ *
+ * Shows how much the measured segment durations are off when the capture ISR
+ * runs late, in each ir_timer_mode_t. The recorded Samsung frame is replayed
+ * through the host backend (see BTHI_IR_Hal_Host.cpp) with a given ISR
+ * latency on every edge, and what the decoder was handed is compared with
+ * what was sent. Build and run it from the library directory:
+ *
+ *  g++ -O2 -I. extras/latency/ir_latency_sim.cpp BTHI_IR_Decoder.cpp \
+ *      BTHI_IR_Hal_Host.cpp -lpthread -o ir_latency_sim
+ *  ./ir_latency_sim
+ *
+ * Each line is one mode and latency:
+ *
+ *  name  mean_err_us  max_err_us  decode
+ *
+ * "fixed" runs use the same latency on every edge, as if the ISR always had
+ * the same entry cost. "jitter" runs pick a latency between 0 and the given
+ * figure for each edge, as if other interrupts (millis(), Serial) sometimes
+ * got there first. decode says whether decodeFrameSamsung() still accepted
+ * the frame.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <BTHI_IR_Decoder.h>
+
+/* How many frames each line is averaged over */
+#define SIM_FRAMES          200
+
+/* Largest frame we replay */
+#define SIM_MAX_SEGMENTS    80
+
+/* Volume up on a Samsung remote, from doc/protocol_info.md */
+static const uint16_t g_recorded_samsung[] = {
+    9067, 8818, 1252, 3273, 1208, 3273, 1208, 3272, 1207, 1025, 1207, 1025,
+    1207, 1024, 1207, 1016, 1207, 1025, 1207, 3273, 1208, 3272, 1209, 3273,
+    1208, 1025, 1207, 1025, 1208, 1024, 1208, 1024, 1206, 1025, 1207, 3273,
+    1208, 3272, 1208, 3273, 1209, 1024, 1208, 1025, 1207, 1025, 1207, 1023,
+    1208, 1024, 1207, 1025, 1207, 1025, 1208, 1025, 1208, 3272, 1208, 3273,
+    1207, 3272, 1208, 3273, 1207, 3273, 1208
+};
+
+#define SIM_NUM_SEGMENTS \
+    (sizeof(g_recorded_samsung) / sizeof(g_recorded_samsung[0]))
+
+/* ISR latencies to try, in us */
+static const uint16_t g_latencies_us[] = { 0, 2, 5, 10, 20, 50, 100, 200 };
+
+static IR_BufferingStreamDecoder g_decoder;
+static ir_segment_t g_buffer[SIM_MAX_SEGMENTS];
+
+/* A tiny LCG, so the jitter is the same on every run */
+static uint32_t g_seed = 1;
+
+static uint16_t randomBelow(uint16_t limit) {
+    g_seed = g_seed * 1103515245UL + 12345UL;
+    return (uint16_t)((g_seed >> 16) % limit);
+}
+
+/**
+ * Replays the recorded frame SIM_FRAMES times and prints one line of results.
+ *
+ * Parameters:
+ *      timer_mode: Passed on to IR_HwInterface::setup().
+ *      latency_us: The ISR latency, or the most it can be if jitter is set.
+ *      jitter: If non-zero, pick a new latency for each edge.
+ *
+ * Return: Nothing
+ */
+static void simulate(ir_timer_mode_t timer_mode, uint16_t latency_us,
+        uint8_t jitter) {
+    static uint32_t now = 0;
+    uint16_t latency_ticks = (uint16_t)IR_US_TO_TICKS(latency_us);
+    uint16_t latency;
+    int32_t error;
+    int64_t total_error = 0;
+    uint32_t max_error = 0;
+    uint32_t measured = 0;
+    uint16_t decoded = 0;
+    uint32_t data;
+    char name[48];
+
+    g_decoder.setSegmentBuffer(g_buffer, SIM_MAX_SEGMENTS);
+    IR_InputCaptureInterface.setup(&g_decoder, 8, IR_POLARITY_AUTO, 0,
+        timer_mode);
+
+    for (uint16_t f = 0; f < SIM_FRAMES; f++) {
+        /* Leave plenty of quiet time after the previous frame */
+        now += 0x20000UL;
+
+        for (uint16_t i = 0; i <= SIM_NUM_SEGMENTS; i++) {
+            if (i > 0) {
+                now += g_recorded_samsung[i - 1];
+            }
+
+            latency = latency_ticks;
+            if ((0 != jitter) && (0 != latency_ticks)) {
+                latency = randomBelow(latency_ticks + 1);
+            }
+            irHostEdge(now, latency);
+        }
+
+        /* The overflow is counted from when the last ISR ran */
+        now += 0x10000UL + latency;
+        irHostIdle(now);
+
+        if (0 == g_decoder.isFrameAvailable()) {
+            continue;
+        }
+
+        for (uint8_t i = 0; i < g_decoder.getSegmentCount(); i++) {
+            error = (int32_t)g_buffer[i].duration - g_recorded_samsung[i];
+            total_error += error;
+            if ((uint32_t)abs(error) > max_error) {
+                max_error = abs(error);
+            }
+            measured++;
+        }
+
+        if ((IR_E_OK == decodeFrameSamsung(&g_decoder, &data))
+                && (0xE0E0E01FUL == data)) {
+            decoded++;
+        }
+
+        g_decoder.readyForNextFrame();
+    }
+
+    snprintf(name, sizeof(name), "%s/%s_%uus",
+        (IR_TIMER_FREE_RUNNING == timer_mode) ? "free_running"
+            : "reset_on_edge",
+        (0 != jitter) ? "jitter" : "fixed", latency_us);
+
+    printf("%-32s %11.2f %11.1f %4u/%u\n", name,
+        (0 != measured) ? (double)total_error * IR_TICK_PERIOD_NS / 1000.0
+            / measured : 0.0,
+        (double)max_error * IR_TICK_PERIOD_NS / 1000.0,
+        decoded, SIM_FRAMES);
+}
+
+int main(void) {
+    printf("%-32s %11s %11s %s\n", "name", "mean_err_us", "max_err_us",
+        "decode");
+
+    for (uint8_t jitter = 0; jitter < 2; jitter++) {
+        for (uint8_t i = 0;
+                i < sizeof(g_latencies_us) / sizeof(g_latencies_us[0]);
+                i++) {
+            simulate(IR_TIMER_RESET_ON_EDGE, g_latencies_us[i], jitter);
+            simulate(IR_TIMER_FREE_RUNNING, g_latencies_us[i], jitter);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,126 @@
+/*---------------------------------------------------------------------------
+ * Streaming Infrared Decoder Library - Timer 1 simulator
+ *
+ * Copyright (c) 2013, Bryan Thomas (BTHI) and Christopher Myers
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *---------------------------------------------------------------------------
+ *
+ * Just enough of Arduino.h and <avr/io.h> for the library to build against
+ * the Timer 1 simulator (see ir_timer1_sim.h). The Timer 1 registers are
+ * backed by the simulator, the input pin is the simulated waveform and
+ * cli()/sei() clear and set the simulated global interrupt flag.
+ */
+#ifndef IR_TIMER1_SIM_ARDUINO_H
+#define IR_TIMER1_SIM_ARDUINO_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <ir_timer1_sim.h>
+
+#define HIGH    1
+#define LOW     0
+#define INPUT   0
+#define HEX     16
+#define DEC     10
+
+/* Timer 1 registers */
+#define TCNT1   (IR_SimRegister(IR_SIM_TCNT1))
+#define ICR1    (IR_SimRegister(IR_SIM_ICR1))
+#define OCR1A   (IR_SimRegister(IR_SIM_OCR1A))
+#define OCR1B   (IR_SimRegister(IR_SIM_OCR1B))
+#define TCCR1A  (IR_SimRegister(IR_SIM_TCCR1A))
+#define TCCR1B  (IR_SimRegister(IR_SIM_TCCR1B))
+#define TCCR1C  (IR_SimRegister(IR_SIM_TCCR1C))
+#define TIMSK1  (IR_SimRegister(IR_SIM_TIMSK1))
+#define TIFR1   (IR_SimRegister(IR_SIM_TIFR1))
+
+/* TCCR1B */
+#define ICNC1   7
+#define ICES1   6
+#define WGM13   4
+#define WGM12   3
+#define CS12    2
+#define CS11    1
+#define CS10    0
+
+/* TIMSK1 */
+#define ICIE1   5
+#define OCIE1B  2
+#define OCIE1A  1
+#define TOIE1   0
+
+/* TIFR1 */
+#define ICF1    5
+#define OCF1B   2
+#define OCF1A   1
+#define TOV1    0
+
+/* The vectors are plain functions that the simulator calls */
+#define ISR(vector, ...) \
+	extern "C" void vector(void) __VA_ARGS__; \
+	extern "C" void vector(void)
+
+extern "C" void TIMER1_CAPT_vect(void);
+extern "C" void TIMER1_COMPA_vect(void);
+extern "C" void TIMER1_OVF_vect(void);
+
+static inline void cli(void) {
+	irSimSetInterruptsEnabled(0);
+}
+
+static inline void sei(void) {
+	irSimSetInterruptsEnabled(1);
+}
+
+#define noInterrupts()  cli()
+#define interrupts()    sei()
+
+/* There's only one input, so the pin number is ignored */
+static inline void pinMode(uint8_t, uint8_t) {
+}
+
+static inline int digitalRead(uint8_t) {
+	return irSimPinLevel();
+}
+
+static inline unsigned long micros(void) {
+	return (unsigned long)(irSimNow() / (IR_SIM_CPU_HZ / 1000000UL));
+}
+
+static inline unsigned long millis(void) {
+	return (unsigned long)(irSimNow() / (IR_SIM_CPU_HZ / 1000UL));
+}
+
+/**
+ * Serial output goes to stdout.
+ */
+class IR_SimSerial {
+public:
+	void begin(long) {}
+	void print(const char *s) { fputs(s, stdout); }
+	void print(long n, int base = DEC) {
+		printf((HEX == base) ? "%lX" : "%ld", n);
+	}
+	void println(void) { putchar('\n'); }
+	void println(const char *s) { print(s); println(); }
+	void println(long n, int base = DEC) { print(n, base); println(); }
+};
+
+extern IR_SimSerial Serial;
+
+#endif
@@ -0,0 +1,34 @@
+/*---------------------------------------------------------------------------
+ * Streaming Infrared Decoder Library - Timer 1 simulator
+ *
+ * Copyright (c) 2013, Bryan Thomas (BTHI) and Christopher Myers
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *---------------------------------------------------------------------------
+ *
+ * Just enough of <avr/pgmspace.h> for IR_HAL_TABLE. The simulator has one
+ * address space, so flash tables are ordinary constant arrays.
+ */
+#ifndef IR_TIMER1_SIM_PGMSPACE_H
+#define IR_TIMER1_SIM_PGMSPACE_H
+
+#include <stdint.h>
+
+#define PROGMEM
+#define pgm_read_byte(address)  (*(const uint8_t *)(address))
+
+#endif
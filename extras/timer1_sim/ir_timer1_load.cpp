@@ -0,0 +1,198 @@
+/*---------------------------------------------------------------------------
+ * Streaming Infrared Decoder Library - ISR behaviour under load
+ *
+ * Copyright (c) 2013, Bryan Thomas (BTHI) and Christopher Myers
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *---------------------------------------------------------------------------
+ *
+ * Runs the real AVR backend (BTHI_IR_Hal_AVR.cpp) and its ISRs on the Timer 1
+ * simulator (see ir_timer1_sim.h), replaying the recorded Samsung frame under
+ * different interrupt loads. Build and run it from the library directory:
+ *
+ *  g++ -O2 -DARDUINO=10800 -D__AVR__ -Iextras/timer1_sim -I. \
+ *      extras/timer1_sim/ir_timer1_load.cpp extras/timer1_sim/ir_timer1_sim.cpp \
+ *      BTHI_IR_Decoder.cpp BTHI_IR_Hal_AVR.cpp -o ir_timer1_load
+ *  ./ir_timer1_load
+ *
+ * Defining __AVR__ and ARDUINO makes the library pick the AVR backend, and
+ * extras/timer1_sim comes first on the include path so that it gets the
+ * simulator's Arduino.h instead of the real one.
+ *
+ * Each line is one scenario and timer mode:
+ *
+ *  name  decode  mean_err_us  max_err_us  overruns  ignored  max_latency_us
+ *
+ * decode is how many frames decodeFrameSamsung() accepted. The errors are
+ * in the segment durations of the frames that had the right number of
+ * segments. overruns is captures lost because ICF1 was still set, ignored is
+ * edges the capture unit didn't look at because ICES1 hadn't been flipped
+ * for them yet (or because the edge before was missed), and max_latency_us
+ * is the longest wait from an edge to its capture ISR.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <Arduino.h>
+#include <BTHI_IR_Decoder.h>
+
+/* How many frames each line replays */
+#define LOAD_FRAMES         100
+
+/* Largest frame we record */
+#define LOAD_MAX_SEGMENTS   80
+
+/* CPU cycles per Timer 1 tick, see IR_TICK_PERIOD_NS */
+#define LOAD_CYCLES_PER_TICK \
+    (IR_TICK_PERIOD_NS / (1000000000UL / IR_SIM_CPU_HZ))
+
+/* Volume up on a Samsung remote, from doc/protocol_info.md */
+static const uint16_t g_recorded_samsung[] = {
+    9067, 8818, 1252, 3273, 1208, 3273, 1208, 3272, 1207, 1025, 1207, 1025,
+    1207, 1024, 1207, 1016, 1207, 1025, 1207, 3273, 1208, 3272, 1209, 3273,
+    1208, 1025, 1207, 1025, 1208, 1024, 1208, 1024, 1206, 1025, 1207, 3273,
+    1208, 3272, 1208, 3273, 1209, 1024, 1208, 1025, 1207, 1025, 1207, 1023,
+    1208, 1024, 1207, 1025, 1207, 1025, 1208, 1025, 1208, 3272, 1208, 3273,
+    1207, 3272, 1208, 3273, 1207, 3273, 1208
+};
+
+#define LOAD_NUM_SEGMENTS \
+    (sizeof(g_recorded_samsung) / sizeof(g_recorded_samsung[0]))
+
+typedef struct {
+    const char *name;
+    uint16_t isr_latency;       /* cycles */
+    uint16_t isr_duration;      /* cycles */
+    uint32_t load_period;       /* cycles, 0 for none */
+    uint32_t load_duration;     /* cycles */
+    uint8_t missed_edge;        /* index of an edge the capture unit misses,
+                                   or 0 for none */
+} load_scenario_t;
+
+/* avr-gcc takes roughly 40 cycles to get into the capture ISR and 150 to get
+ * through it with IR_BufferingStreamDecoder behind it.
+ */
+static const load_scenario_t g_scenarios[] = {
+    { "idle",               40, 150,     0,     0,  0 },
+    /* Timer 0 overflow for millis(), every 1.024ms for about 6us */
+    { "millis",             40, 150, 16384,   100,  0 },
+    /* A busy Serial port at 115200 baud, every 87us for about 5us */
+    { "millis_serial",      40, 150,  1389,    80,  0 },
+    /* Some other library keeping interrupts off for 100us every 2ms */
+    { "long_critical",      40, 150, 32000,  1600,  0 },
+    /* Keeping them off for 800us, longer than the shortest segment */
+    { "very_long_critical", 40, 150, 32000, 12800,  0 },
+    /* One bit mark too short for the noise canceller */
+    { "missed_edge",        40, 150,     0,     0, 20 },
+};
+
+static IR_BufferingStreamDecoder g_decoder;
+static ir_segment_t g_buffer[LOAD_MAX_SEGMENTS];
+
+/**
+ * Replays the recorded frame LOAD_FRAMES times for one scenario and mode,
+ * and prints one line of results.
+ */
+static void runScenario(const load_scenario_t *scenario,
+        ir_timer_mode_t timer_mode) {
+    uint64_t now;
+    uint32_t seed = 1;
+    int32_t error;
+    int64_t total_error = 0;
+    uint32_t max_error = 0;
+    uint32_t measured = 0;
+    uint16_t decoded = 0;
+    uint32_t data;
+    ir_sim_stats_t stats;
+    char name[48];
+
+    irSimReset(HIGH);
+    irSimSetIsrTiming(scenario->isr_latency, scenario->isr_duration);
+    irSimSetLoad(scenario->load_period, scenario->load_duration);
+
+    g_decoder.setSegmentBuffer(g_buffer, LOAD_MAX_SEGMENTS);
+    IR_InputCaptureInterface.setup(&g_decoder, 8, IR_POLARITY_AUTO, 0,
+        timer_mode);
+
+    now = IR_SIM_US_TO_CYCLES(1000);
+    for (uint16_t f = 0; f < LOAD_FRAMES; f++) {
+        /* Start each frame at a different point relative to the load */
+        seed = seed * 1103515245UL + 12345UL;
+        now += IR_SIM_US_TO_CYCLES(50000) + ((seed >> 16) % 40000);
+
+        irSimEdge(now);
+        for (uint8_t i = 0; i < LOAD_NUM_SEGMENTS; i++) {
+            now += (uint64_t)g_recorded_samsung[i] * LOAD_CYCLES_PER_TICK;
+            irSimEdge(now, (0 != scenario->missed_edge)
+                && (i + 1 == scenario->missed_edge));
+        }
+
+        /* Plenty of time for the end of frame, whichever way it's done */
+        now += 0x10000UL * LOAD_CYCLES_PER_TICK + IR_SIM_US_TO_CYCLES(2000);
+        irSimRun(now);
+
+        if (0 == g_decoder.isFrameAvailable()) {
+            continue;
+        }
+
+        if (LOAD_NUM_SEGMENTS == g_decoder.getSegmentCount()) {
+            for (uint8_t i = 0; i < LOAD_NUM_SEGMENTS; i++) {
+                error = (int32_t)g_buffer[i].duration - g_recorded_samsung[i];
+                total_error += error;
+                if ((uint32_t)abs(error) > max_error) {
+                    max_error = abs(error);
+                }
+                measured++;
+            }
+        }
+
+        if ((IR_E_OK == decodeFrameSamsung(&g_decoder, &data))
+                && (0xE0E0E01FUL == data)) {
+            decoded++;
+        }
+
+        cli();
+        g_decoder.readyForNextFrame();
+        sei();
+    }
+
+    irSimGetStats(&stats);
+
+    snprintf(name, sizeof(name), "%s/%s", scenario->name,
+        (IR_TIMER_FREE_RUNNING == timer_mode) ? "free_running"
+            : "reset_on_edge");
+
+    printf("%-36s %3u/%u %11.2f %10.1f %8u %7u %14.1f\n", name, decoded,
+        LOAD_FRAMES,
+        (0 != measured) ? (double)total_error * IR_TICK_PERIOD_NS / 1000.0
+            / measured : 0.0,
+        (double)max_error * IR_TICK_PERIOD_NS / 1000.0,
+        stats.missed_captures, stats.ignored_edges,
+        (double)stats.max_capture_latency / (IR_SIM_CPU_HZ / 1000000UL));
+}
+
+int main(void) {
+    printf("%-36s %7s %11s %10s %8s %7s %14s\n", "name", "decode",
+        "mean_err_us", "max_err_us", "overruns", "ignored", "max_latency_us");
+
+    for (uint8_t i = 0; i < sizeof(g_scenarios) / sizeof(g_scenarios[0]);
+            i++) {
+        runScenario(&g_scenarios[i], IR_TIMER_RESET_ON_EDGE);
+        runScenario(&g_scenarios[i], IR_TIMER_FREE_RUNNING);
+    }
+
+    return 0;
+}
@@ -0,0 +1,471 @@
+/*---------------------------------------------------------------------------
+ * Streaming Infrared Decoder Library - Timer 1 simulator
+ *
+ * Copyright (c) 2013, Bryan Thomas (BTHI) and Christopher Myers
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *---------------------------------------------------------------------------
+ *
+ * Implementation of the Timer 1 model. See ir_timer1_sim.h.
+ *
+ * Rather than stepping cycle by cycle, the counter is kept as the value it
+ * had at some cycle (the last write to TCNT1 or change of prescaler) and
+ * everything else is worked out from that: what TCNT1 reads now, and when it
+ * will next wrap or match OCR1A. irSimRun() then jumps from one event to the
+ * next.
+ */
+#include <string.h>
+#include <Arduino.h>
+#include <ir_timer1_sim.h>
+
+#define IR_SIM_NEVER            (~(uint64_t)0)
+
+/* Cycles the noise canceller delays a capture by */
+#define IR_SIM_NOISE_CANCELLER  4
+
+/* Interrupt flags that have a matching enable bit in TIMSK1, which are the
+ * only ones we serve
+ */
+#define IR_SIM_SERVED_FLAGS     ((1 << ICF1) | (1 << OCF1A) | (1 << TOV1))
+
+IR_SimSerial Serial;
+
+/* Simulated time and pin */
+static uint64_t g_now;
+static uint8_t g_pin_level;
+
+/* CPU state */
+static uint8_t g_interrupts_enabled;
+static uint64_t g_busy_until;
+static uint16_t g_isr_latency;
+static uint16_t g_isr_duration;
+static uint32_t g_load_period;
+static uint32_t g_load_duration;
+
+/* TCNT1 was g_count_value at g_count_cycle */
+static uint16_t g_count_value;
+static uint64_t g_count_cycle;
+
+/* The rest of the registers */
+static uint16_t g_icr1;
+static uint16_t g_ocr1a;
+static uint16_t g_ocr1b;
+static uint8_t g_tccr1a;
+static uint8_t g_tccr1b;
+static uint8_t g_tccr1c;
+static uint8_t g_timsk1;
+static uint8_t g_tifr1;
+
+/* When each TIFR1 flag was last raised */
+static uint64_t g_flag_cycle[8];
+
+static ir_sim_stats_t g_stats;
+
+/**
+ * Return: How many CPU cycles one timer tick takes with the current clock
+ *      select bits, or 0 if the timer is stopped (or clocked externally,
+ *      which we don't support).
+ */
+static uint16_t prescaler(void) {
+    switch (g_tccr1b & ((1 << CS12) | (1 << CS11) | (1 << CS10))) {
+    case 1:
+        return 1;
+    case 2:
+        return 8;
+    case 3:
+        return 64;
+    case 4:
+        return 256;
+    case 5:
+        return 1024;
+    }
+
+    return 0;
+}
+
+/**
+ * Return: The ticks counted since g_count_cycle, as of g_now.
+ */
+static uint64_t ticksCounted(void) {
+    uint16_t ps = prescaler();
+
+    if (0 == ps) {
+        return 0;
+    }
+    return (g_now - g_count_cycle) / ps;
+}
+
+static uint16_t counterValue(void) {
+    return (uint16_t)(g_count_value + ticksCounted());
+}
+
+/**
+ * Restarts the bookkeeping from the current value. Needed whenever the
+ * prescaler changes.
+ */
+static void rebaseCounter(void) {
+    g_count_value = counterValue();
+    g_count_cycle = g_now;
+}
+
+/**
+ * Works out when TCNT1 will next change to the given value.
+ *
+ * Parameters:
+ *      target: The value to wait for. 0 is the overflow.
+ *
+ * Return: The cycle at which it happens, which is always after g_now, or
+ *      IR_SIM_NEVER if the timer is stopped.
+ */
+static uint64_t nextCount(uint16_t target) {
+    uint16_t ps = prescaler();
+    uint64_t elapsed;
+    uint32_t ticks;
+
+    if (0 == ps) {
+        return IR_SIM_NEVER;
+    }
+
+    elapsed = ticksCounted();
+    ticks = (uint16_t)(target - (uint16_t)(g_count_value + elapsed));
+    if (0 == ticks) {
+        ticks = 0x10000UL;
+    }
+
+    return g_count_cycle + (elapsed + ticks) * ps;
+}
+
+static void raiseFlag(uint8_t flag) {
+    g_tifr1 |= (1 << flag);
+    g_flag_cycle[flag] = g_now;
+}
+
+/**
+ * Works out when the CPU will next get to one of our interrupt vectors. That
+ * needs a flag raised with its interrupt enabled, global interrupts on, our
+ * own previous ISR finished, the entry latency to have passed and the load
+ * not to be running.
+ *
+ * Return: The cycle, or IR_SIM_NEVER if nothing is pending.
+ */
+static uint64_t nextService(void) {
+    uint8_t pending = g_tifr1 & g_timsk1 & IR_SIM_SERVED_FLAGS;
+    uint64_t at = IR_SIM_NEVER;
+    uint64_t phase;
+
+    if ((0 == pending) || (0 == g_interrupts_enabled)) {
+        return IR_SIM_NEVER;
+    }
+
+    for (uint8_t flag = 0; flag < 8; flag++) {
+        if ((0 != (pending & (1 << flag)))
+                && (g_flag_cycle[flag] + g_isr_latency < at)) {
+            at = g_flag_cycle[flag] + g_isr_latency;
+        }
+    }
+
+    if (at < g_now) {
+        at = g_now;
+    }
+    if (at < g_busy_until) {
+        at = g_busy_until;
+    }
+
+    if (0 != g_load_period) {
+        phase = at % g_load_period;
+        if (phase < g_load_duration) {
+            at += g_load_duration - phase;
+        }
+    }
+
+    return at;
+}
+
+/**
+ * Runs the highest priority pending vector at g_now. As on the chip, the
+ * flag is cleared on the way in and interrupts are off until it returns.
+ */
+static void serveInterrupt(void) {
+    uint8_t pending = g_tifr1 & g_timsk1 & IR_SIM_SERVED_FLAGS;
+    uint32_t latency;
+
+    g_interrupts_enabled = 0;
+
+    if (0 != (pending & (1 << ICF1))) {
+        g_tifr1 &= ~(1 << ICF1);
+        latency = (uint32_t)(g_now - g_flag_cycle[ICF1]);
+        if (latency > g_stats.max_capture_latency) {
+            g_stats.max_capture_latency = latency;
+        }
+        g_stats.capture_interrupts++;
+        TIMER1_CAPT_vect();
+    } else if (0 != (pending & (1 << OCF1A))) {
+        g_tifr1 &= ~(1 << OCF1A);
+        g_stats.compare_interrupts++;
+        TIMER1_COMPA_vect();
+    } else {
+        g_tifr1 &= ~(1 << TOV1);
+        g_stats.overflow_interrupts++;
+        TIMER1_OVF_vect();
+    }
+
+    g_interrupts_enabled = 1;
+    g_busy_until = g_now + g_isr_duration;
+}
+
+uint16_t irSimReadRegister(uint8_t reg) {
+    switch (reg) {
+    case IR_SIM_TCNT1:
+        return counterValue();
+    case IR_SIM_ICR1:
+        return g_icr1;
+    case IR_SIM_OCR1A:
+        return g_ocr1a;
+    case IR_SIM_OCR1B:
+        return g_ocr1b;
+    case IR_SIM_TCCR1A:
+        return g_tccr1a;
+    case IR_SIM_TCCR1B:
+        return g_tccr1b;
+    case IR_SIM_TCCR1C:
+        return g_tccr1c;
+    case IR_SIM_TIMSK1:
+        return g_timsk1;
+    case IR_SIM_TIFR1:
+        return g_tifr1;
+    }
+
+    return 0;
+}
+
+void irSimWriteRegister(uint8_t reg, uint16_t value) {
+    switch (reg) {
+    case IR_SIM_TCNT1:
+        g_count_value = value;
+        g_count_cycle = g_now;
+        break;
+    case IR_SIM_ICR1:
+        g_icr1 = value;
+        break;
+    case IR_SIM_OCR1A:
+        g_ocr1a = value;
+        break;
+    case IR_SIM_OCR1B:
+        g_ocr1b = value;
+        break;
+    case IR_SIM_TCCR1A:
+        g_tccr1a = (uint8_t)value;
+        break;
+    case IR_SIM_TCCR1B:
+        rebaseCounter();
+        g_tccr1b = (uint8_t)value;
+        break;
+    case IR_SIM_TCCR1C:
+        g_tccr1c = (uint8_t)value;
+        break;
+    case IR_SIM_TIMSK1:
+        g_timsk1 = (uint8_t)value;
+        break;
+    case IR_SIM_TIFR1:
+        /* Flags are cleared by writing a 1 to them */
+        g_tifr1 &= ~(uint8_t)value;
+        break;
+    }
+}
+
+/**
+ * Puts the chip back into its reset state at cycle 0: timer stopped, all
+ * registers 0 and global interrupts off. ISR timing and load are cleared
+ * too.
+ *
+ * Parameters:
+ *      pin_level: The level of the input pin, HIGH or LOW. Most IR
+ *          receivers idle HIGH.
+ *
+ * Return: Nothing
+ */
+void irSimReset(uint8_t pin_level) {
+    g_now = 0;
+    g_pin_level = pin_level;
+    g_interrupts_enabled = 0;
+    g_busy_until = 0;
+    g_isr_latency = 0;
+    g_isr_duration = 0;
+    g_load_period = 0;
+    g_load_duration = 0;
+    g_count_value = 0;
+    g_count_cycle = 0;
+    g_icr1 = 0;
+    g_ocr1a = 0;
+    g_ocr1b = 0;
+    g_tccr1a = 0;
+    g_tccr1b = 0;
+    g_tccr1c = 0;
+    g_timsk1 = 0;
+    g_tifr1 = 0;
+    memset(g_flag_cycle, 0, sizeof(g_flag_cycle));
+    memset(&g_stats, 0, sizeof(g_stats));
+}
+
+/**
+ * Sets how long our ISRs take.
+ *
+ * Parameters:
+ *      isr_latency: Cycles from an interrupt flag being raised until the
+ *          first statement of its ISR runs, when nothing else is in the way.
+ *          On the atmega328 that's at least 7 cycles to get to the vector,
+ *          plus however long the compiler's prologue is.
+ *      isr_duration: Cycles from then until the ISR returns. No other
+ *          interrupt is served in the meantime.
+ *
+ * Return: Nothing
+ */
+void irSimSetIsrTiming(uint16_t isr_latency, uint16_t isr_duration) {
+    g_isr_latency = isr_latency;
+    g_isr_duration = isr_duration;
+}
+
+/**
+ * Simulates some other interrupt (or a section with interrupts off) that
+ * keeps our ISRs from running for a while, every so often. The first one
+ * starts at cycle 0.
+ *
+ * Parameters:
+ *      period: Cycles from the start of one to the start of the next, or 0
+ *          for no load.
+ *      duration: Cycles that each one lasts.
+ *
+ * Return: Nothing
+ */
+void irSimSetLoad(uint32_t period, uint32_t duration) {
+    g_load_period = period;
+    g_load_duration = duration;
+}
+
+/**
+ * Lets time pass, raising flags and running ISRs as they come due.
+ *
+ * Parameters:
+ *      until: The cycle to run up to. Nothing happens if it's in the past.
+ *
+ * Return: Nothing
+ */
+void irSimRun(uint64_t until) {
+    uint64_t overflow_at;
+    uint64_t compare_at;
+    uint64_t hardware_at;
+    uint64_t service_at;
+
+    for (;;) {
+        overflow_at = nextCount(0);
+        compare_at = nextCount(g_ocr1a);
+        hardware_at = (overflow_at < compare_at) ? overflow_at : compare_at;
+        service_at = nextService();
+
+        if (hardware_at <= service_at) {
+            if (hardware_at > until) {
+                break;
+            }
+            g_now = hardware_at;
+            if (hardware_at == overflow_at) {
+                raiseFlag(TOV1);
+            }
+            if (hardware_at == compare_at) {
+                raiseFlag(OCF1A);
+            }
+        } else {
+            if (service_at > until) {
+                break;
+            }
+            g_now = service_at;
+            serveInterrupt();
+        }
+    }
+
+    if (until > g_now) {
+        g_now = until;
+    }
+}
+
+/**
+ * Toggles the input pin, running everything up to that point first. If the
+ * new level matches the edge ICES1 is looking for, the capture unit latches
+ * TCNT1 into ICR1 and raises ICF1 (after the noise canceller delay, if it's
+ * on).
+ *
+ * Parameters:
+ *      at: The cycle of the edge. Must not be before the previous one.
+ *      missed: If non-zero, the pin still changes but the capture unit
+ *          doesn't see it, as if it were too short to get past the noise
+ *          canceller.
+ *
+ * Return: Nothing
+ */
+void irSimEdge(uint64_t at, uint8_t missed) {
+    uint8_t rising;
+
+    irSimRun(at);
+    g_pin_level = (HIGH == g_pin_level) ? LOW : HIGH;
+    rising = (HIGH == g_pin_level);
+    g_stats.edges++;
+
+    if (0 != missed) {
+        return;
+    }
+
+    if (0 != (g_tccr1b & (1 << ICNC1))) {
+        irSimRun(at + IR_SIM_NOISE_CANCELLER);
+    }
+
+    if (rising != (0 != (g_tccr1b & (1 << ICES1)))) {
+        g_stats.ignored_edges++;
+        return;
+    }
+
+    if (0 != (g_tifr1 & (1 << ICF1))) {
+        /* The ISR hasn't got to the last one yet. It's gone. */
+        g_stats.missed_captures++;
+    }
+
+    g_icr1 = counterValue();
+    raiseFlag(ICF1);
+    g_stats.captures++;
+}
+
+uint64_t irSimNow(void) {
+    return g_now;
+}
+
+uint8_t irSimPinLevel(void) {
+    return g_pin_level;
+}
+
+/**
+ * Backs cli() and sei(). Turning interrupts on lets anything pending run at
+ * the next irSimRun().
+ */
+void irSimSetInterruptsEnabled(uint8_t enabled) {
+    g_interrupts_enabled = enabled;
+}
+
+/**
+ * Copies out the counts of what's happened since irSimReset(). Latencies
+ * are in cycles.
+ */
+void irSimGetStats(ir_sim_stats_t *stats) {
+    *stats = g_stats;
+}
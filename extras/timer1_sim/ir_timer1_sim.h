@@ -0,0 +1,139 @@
+/*---------------------------------------------------------------------------
+ * Streaming Infrared Decoder Library - Timer 1 simulator
+ *
+ * Copyright (c) 2013, Bryan Thomas (BTHI) and Christopher Myers
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *---------------------------------------------------------------------------
+ *
+ * A register-level model of the atmega328's Timer 1, so that the real AVR
+ * backend (BTHI_IR_Hal_AVR.cpp) and its ISRs can run unmodified on a regular
+ * computer. Unlike the host backend (BTHI_IR_Hal_Host.cpp), nothing here
+ * knows about IR_HwInterface: the ISRs read and write TCNT1, ICR1, OCR1A,
+ * TCCR1B, TIMSK1 and TIFR1 exactly as they would on the chip, and this model
+ * decides when the counter wraps, when an edge is captured and when each
+ * interrupt vector gets to run.
+ *
+ * Time is counted in CPU cycles at IR_SIM_CPU_HZ. The program describes the
+ * waveform with irSimEdge() and lets time pass with irSimRun(). What's
+ * modelled:
+ *
+ *   - TCNT1 counting at the prescaler chosen by the CS1x bits in TCCR1B,
+ *     wrapping at 0xFFFF and setting TOV1.
+ *   - Output compare A matches setting OCF1A.
+ *   - Input capture on the edge direction chosen by ICES1, latching ICR1 and
+ *     setting ICF1, with the 4 cycle delay of the noise canceller (ICNC1).
+ *     An edge in the other direction is not captured at all, which is
+ *     counted as an ignored edge.
+ *   - A capture arriving while ICF1 is still set overwrites ICR1, losing the
+ *     previous one. That is counted as a missed capture.
+ *   - Interrupts are served in vector priority order (CAPT, COMPA, OVF) when
+ *     the global interrupt flag is set, isr_latency cycles after their flag
+ *     was raised at the earliest. Serving one clears its flag and holds off
+ *     the others for isr_duration cycles.
+ *   - A periodic load, such as the Timer 0 millis() interrupt, during which
+ *     none of our interrupts can be served.
+ *
+ * Not modelled: the other timer modes, OCR1B, PWM output and the prescaler
+ * phase (the prescaler starts counting from the last write to TCNT1).
+ *
+ * See ir_timer1_load.cpp for a program that uses it, and how to build
+ * against it.
+ */
+#ifndef IR_TIMER1_SIM_H
+#define IR_TIMER1_SIM_H
+
+#include <stdint.h>
+
+/* Clock of the simulated chip, as on the UNO */
+#define IR_SIM_CPU_HZ           16000000UL
+
+#define IR_SIM_US_TO_CYCLES(us) ((uint64_t)(us) * (IR_SIM_CPU_HZ / 1000000UL))
+
+/* Timer 1 registers, see the atmega328 datasheet */
+#define IR_SIM_TCNT1    0
+#define IR_SIM_ICR1     1
+#define IR_SIM_OCR1A    2
+#define IR_SIM_OCR1B    3
+#define IR_SIM_TCCR1A   4
+#define IR_SIM_TCCR1B   5
+#define IR_SIM_TCCR1C   6
+#define IR_SIM_TIMSK1   7
+#define IR_SIM_TIFR1    8
+
+extern uint16_t irSimReadRegister(uint8_t reg);
+extern void irSimWriteRegister(uint8_t reg, uint16_t value);
+
+/**
+ * Stands in for one of the memory mapped Timer 1 registers, so that
+ * statements like "TIMSK1 &= ~(1 << TOIE1)" behave as they would on the chip.
+ */
+class IR_SimRegister {
+private:
+	uint8_t _reg;
+
+public:
+	IR_SimRegister(uint8_t reg) : _reg(reg) {}
+
+	operator uint16_t() const {
+		return irSimReadRegister(_reg);
+	}
+
+	IR_SimRegister &operator=(uint16_t value) {
+		irSimWriteRegister(_reg, value);
+		return *this;
+	}
+
+	IR_SimRegister &operator=(const IR_SimRegister &other) {
+		irSimWriteRegister(_reg, (uint16_t)other);
+		return *this;
+	}
+
+	IR_SimRegister &operator|=(uint16_t value) {
+		irSimWriteRegister(_reg, irSimReadRegister(_reg) | value);
+		return *this;
+	}
+
+	IR_SimRegister &operator&=(uint16_t value) {
+		irSimWriteRegister(_reg, irSimReadRegister(_reg) & value);
+		return *this;
+	}
+};
+
+/* What happened during a simulation, see irSimGetStats() */
+typedef struct {
+	uint32_t edges;
+	uint32_t captures;
+	uint32_t missed_captures;
+	uint32_t ignored_edges;
+	uint32_t capture_interrupts;
+	uint32_t compare_interrupts;
+	uint32_t overflow_interrupts;
+	uint32_t max_capture_latency;
+} ir_sim_stats_t;
+
+extern void irSimReset(uint8_t pin_level);
+extern void irSimSetIsrTiming(uint16_t isr_latency, uint16_t isr_duration);
+extern void irSimSetLoad(uint32_t period, uint32_t duration);
+extern void irSimRun(uint64_t until);
+extern void irSimEdge(uint64_t at, uint8_t missed = 0);
+extern uint64_t irSimNow(void);
+extern uint8_t irSimPinLevel(void);
+extern void irSimSetInterruptsEnabled(uint8_t enabled);
+extern void irSimGetStats(ir_sim_stats_t *stats);
+
+#endif
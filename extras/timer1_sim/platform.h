@@ -0,0 +1,5 @@
+/*
+ * BTHI_IR_Decoder.h includes this on Arduino builds. Everything it needs is
+ * in the simulator's Arduino.h.
+ */
+#include <Arduino.h>
@@ -0,0 +1,361 @@
+/*---------------------------------------------------------------------------
+ * Streaming Infrared Decoder Library - segment trace files
+ *
+ * Copyright (c) 2013, Bryan Thomas (BTHI) and Christopher Myers
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *---------------------------------------------------------------------------
+ *
+ * Reader, writer and replay driver for trace files. See ir_trace.h for the
+ * format.
+ */
+#include <string.h>
+#include <time.h>
+#include <ir_trace.h>
+
+/* Quiet time between frames when the trace has no timestamps. Longer than
+ * any end-of-frame gap, so every frame is ended on its own.
+ */
+#define IR_TRACE_FRAME_SPACING      0x20000UL
+
+/* Size of the fixed part of the file header */
+#define IR_TRACE_HEADER_SIZE        12
+
+/* Longest frame irTraceReplay() can handle */
+#define IR_TRACE_MAX_REPLAY         1024
+
+static void put16(uint8_t *p, uint16_t value) {
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+}
+
+static void put32(uint8_t *p, uint32_t value) {
+    put16(p, (uint16_t)value);
+    put16(p + 2, (uint16_t)(value >> 16));
+}
+
+static uint16_t get16(const uint8_t *p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get32(const uint8_t *p) {
+    return get16(p) | ((uint32_t)get16(p + 2) << 16);
+}
+
+/**
+ * Fills in a header for a new trace of durations measured in Timer 1 ticks
+ * (see IR_TICK_PERIOD_NS).
+ *
+ * Parameters:
+ *      header: The header to fill in.
+ *      source: Where the trace came from, for example the remote and
+ *          button. Truncated to 255 characters. May be NULL.
+ *      flags: IR_TRACE_F_* flags.
+ *
+ * Return: Nothing
+ */
+void irTraceInitHeader(ir_trace_header_t *header, const char *source,
+        uint8_t flags) {
+    memset(header, 0, sizeof(*header));
+    header->flags = flags;
+    header->polarity = IR_POLARITY_AUTO;
+    header->tick_period_ns = IR_TICK_PERIOD_NS;
+    if (NULL != source) {
+        strncpy(header->source, source, sizeof(header->source) - 1);
+    }
+}
+
+/**
+ * Writes the file header. Must be the first thing written.
+ *
+ * Return: IR_E_OK, or IR_TRACE_E_IO if the write failed.
+ */
+int8_t irTraceWriteHeader(FILE *file, const ir_trace_header_t *header) {
+    uint8_t raw[IR_TRACE_HEADER_SIZE];
+    size_t source_length = strlen(header->source);
+
+    memcpy(raw, IR_TRACE_MAGIC, 4);
+    raw[4] = IR_TRACE_VERSION;
+    raw[5] = header->flags;
+    raw[6] = (uint8_t)header->polarity;
+    raw[7] = (uint8_t)source_length;
+    put32(raw + 8, header->tick_period_ns);
+
+    if ((1 != fwrite(raw, sizeof(raw), 1, file))
+            || (source_length != fwrite(header->source, 1, source_length,
+                file))) {
+        return IR_TRACE_E_IO;
+    }
+
+    return IR_E_OK;
+}
+
+/**
+ * Appends one frame.
+ *
+ * Parameters:
+ *      file: The trace, positioned after the header or the last frame.
+ *      header: The header that was written to it.
+ *      timestamp: Time of the frame's leading edge in ticks. Ignored unless
+ *          the header has IR_TRACE_F_TIMESTAMPS.
+ *      segments: The segment durations.
+ *      count: The number of segments.
+ *
+ * Return: IR_E_OK, or IR_TRACE_E_IO if the write failed.
+ */
+int8_t irTraceWriteFrame(FILE *file, const ir_trace_header_t *header,
+        uint32_t timestamp, const ir_segment_t *segments, uint16_t count) {
+    uint8_t raw[6];
+    size_t size = 2;
+
+    put16(raw, count);
+    if (0 != (header->flags & IR_TRACE_F_TIMESTAMPS)) {
+        put32(raw + 2, timestamp);
+        size += 4;
+    }
+
+    if (1 != fwrite(raw, size, 1, file)) {
+        return IR_TRACE_E_IO;
+    }
+
+    for (uint16_t i = 0; i < count; i++) {
+        put16(raw, segments[i].duration);
+        if (1 != fwrite(raw, 2, 1, file)) {
+            return IR_TRACE_E_IO;
+        }
+    }
+
+    return IR_E_OK;
+}
+
+/**
+ * Reads and checks the file header. Must be the first thing read.
+ *
+ * Return: IR_E_OK, IR_TRACE_E_IO if the file is too short or
+ *      IR_TRACE_E_BAD_FORMAT if it isn't a trace this version understands.
+ */
+int8_t irTraceReadHeader(FILE *file, ir_trace_header_t *header) {
+    uint8_t raw[IR_TRACE_HEADER_SIZE];
+
+    memset(header, 0, sizeof(*header));
+
+    if (1 != fread(raw, sizeof(raw), 1, file)) {
+        return IR_TRACE_E_IO;
+    }
+
+    if ((0 != memcmp(raw, IR_TRACE_MAGIC, 4))
+            || (IR_TRACE_VERSION != raw[4])
+            || (raw[6] > IR_POLARITY_AUTO)
+            || (0 == get32(raw + 8))) {
+        return IR_TRACE_E_BAD_FORMAT;
+    }
+
+    header->flags = raw[5];
+    header->polarity = (ir_polarity_t)raw[6];
+    header->tick_period_ns = get32(raw + 8);
+
+    if ((0 != raw[7]) && (1 != fread(header->source, raw[7], 1, file))) {
+        return IR_TRACE_E_IO;
+    }
+
+    return IR_E_OK;
+}
+
+/**
+ * Reads the next frame.
+ *
+ * Parameters:
+ *      file: The trace, positioned after the header or the last frame.
+ *      header: The header read from it.
+ *      timestamp: Gets the time of the frame's leading edge, or 0 if the
+ *          trace has no timestamps. May be NULL.
+ *      segments: Where to put the durations, as they are in the file.
+ *      max_segments: How many segments fit.
+ *      count: Gets the number of segments in the frame.
+ *
+ * Return: IR_E_OK, IR_TRACE_E_END if there are no more frames, IR_TRACE_E_IO
+ *      if the file ends part way through a frame or IR_TRACE_E_FRAME_TOO_LONG
+ *      if the frame doesn't fit (it is skipped, so the next call reads the
+ *      following one).
+ */
+int8_t irTraceReadFrame(FILE *file, const ir_trace_header_t *header,
+        uint32_t *timestamp, ir_segment_t *segments, uint16_t max_segments,
+        uint16_t *count) {
+    uint8_t raw[4];
+
+    if (1 != fread(raw, 2, 1, file)) {
+        return feof(file) ? IR_TRACE_E_END : IR_TRACE_E_IO;
+    }
+    *count = get16(raw);
+
+    if (NULL != timestamp) {
+        *timestamp = 0;
+    }
+    if (0 != (header->flags & IR_TRACE_F_TIMESTAMPS)) {
+        if (1 != fread(raw, 4, 1, file)) {
+            return IR_TRACE_E_IO;
+        }
+        if (NULL != timestamp) {
+            *timestamp = get32(raw);
+        }
+    }
+
+    if (*count > max_segments) {
+        if (0 != fseek(file, 2L * *count, SEEK_CUR)) {
+            return IR_TRACE_E_IO;
+        }
+        return IR_TRACE_E_FRAME_TOO_LONG;
+    }
+
+    for (uint16_t i = 0; i < *count; i++) {
+        if (1 != fread(raw, 2, 1, file)) {
+            return IR_TRACE_E_IO;
+        }
+        segments[i].duration = get16(raw);
+    }
+
+    return IR_E_OK;
+}
+
+/**
+ * Sleeps for a number of Timer 1 ticks.
+ */
+static void sleepTicks(uint32_t ticks) {
+    uint64_t ns = (uint64_t)ticks * IR_TICK_PERIOD_NS;
+    struct timespec delay;
+
+    delay.tv_sec = (time_t)(ns / 1000000000ULL);
+    delay.tv_nsec = (long)(ns % 1000000000ULL);
+    nanosleep(&delay, NULL);
+}
+
+/**
+ * Converts a duration from the trace's tick period to ours, saturating at
+ * the longest duration the timer can measure.
+ */
+static uint16_t toTicks(const ir_trace_header_t *header, uint16_t duration) {
+    uint64_t ticks;
+
+    if (IR_TICK_PERIOD_NS == header->tick_period_ns) {
+        return duration;
+    }
+
+    ticks = ((uint64_t)duration * header->tick_period_ns
+        + IR_TICK_PERIOD_NS / 2) / IR_TICK_PERIOD_NS;
+    return (ticks > 0xFFFF) ? 0xFFFF : (uint16_t)ticks;
+}
+
+/**
+ * Plays the rest of a trace into a decoder through IR_InputCaptureInterface
+ * and the host backend (see irHostEdge()), so the decoder sees the same
+ * calls, in the same order, as it would from the capture ISR. Durations are
+ * converted if the trace was recorded with a different tick period.
+ *
+ * If the trace has timestamps, the time between frames is kept (so frames
+ * closer together than the end-of-frame gap run together, as they would
+ * have live). Otherwise frames are spaced far enough apart that each one is
+ * ended on its own.
+ *
+ * Parameters:
+ *      file: The trace, positioned after the header.
+ *      header: The header read from it.
+ *      decoder: Where the edges go. IR_InputCaptureInterface is set up to
+ *          deliver to it.
+ *      real_time: If non-zero, sleep so that the trace takes as long as it
+ *          did to record. Otherwise, go as fast as possible.
+ *      callback: Called after the end of each frame has been signalled, or
+ *          NULL. This is where to check isFrameAvailable().
+ *      context: Passed to the callback.
+ *
+ * Return: IR_E_OK once the whole trace has been played, or the error from
+ *      irTraceReadFrame() that stopped it.
+ */
+int8_t irTraceReplay(FILE *file, const ir_trace_header_t *header,
+        IR_StreamDecoder *decoder, uint8_t real_time,
+        ir_trace_frame_callback_t callback, void *context) {
+    static ir_segment_t segments[IR_TRACE_MAX_REPLAY];
+    uint32_t now = 0;
+    uint32_t start = 0;
+    uint32_t timestamp;
+    uint32_t previous_timestamp = 0;
+    uint16_t duration;
+    uint16_t count;
+    uint8_t first = 1;
+    int8_t res;
+
+    IR_InputCaptureInterface.setup(decoder, 8, header->polarity);
+
+    for (;;) {
+        res = irTraceReadFrame(file, header, &timestamp, segments,
+            IR_TRACE_MAX_REPLAY, &count);
+        if (IR_TRACE_E_END == res) {
+            break;
+        } else if (IR_E_OK != res) {
+            return res;
+        }
+
+        if ((0 == first)
+                && (0 != (header->flags & IR_TRACE_F_TIMESTAMPS))) {
+            start += (uint32_t)((uint64_t)(uint32_t)(timestamp
+                - previous_timestamp) * header->tick_period_ns
+                / IR_TICK_PERIOD_NS);
+
+            /* Can't start before the last frame finished */
+            if ((int32_t)(start - now) <= 0) {
+                start = now + 1;
+            }
+        } else {
+            start = now + IR_TRACE_FRAME_SPACING;
+        }
+        previous_timestamp = timestamp;
+
+        if (0 != real_time) {
+            sleepTicks(start - now);
+        }
+
+        /* Ends the previous frame, if it's been long enough */
+        irHostIdle(start);
+        if ((0 == first) && (NULL != callback)) {
+            callback(context);
+        }
+        first = 0;
+
+        now = start;
+        irHostEdge(now);
+        for (uint16_t i = 0; i < count; i++) {
+            duration = toTicks(header, segments[i].duration);
+            if (0 != real_time) {
+                sleepTicks(duration);
+            }
+            now += duration;
+            irHostEdge(now);
+        }
+    }
+
+    if (0 == first) {
+        now += IR_TRACE_FRAME_SPACING;
+        if (0 != real_time) {
+            sleepTicks(IR_TRACE_FRAME_SPACING);
+        }
+        irHostIdle(now);
+        if (NULL != callback) {
+            callback(context);
+        }
+    }
+
+    return IR_E_OK;
+}
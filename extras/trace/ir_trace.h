@@ -0,0 +1,101 @@
+/*---------------------------------------------------------------------------
+ * Streaming Infrared Decoder Library - segment trace files
+ *
+ * Copyright (c) 2013, Bryan Thomas (BTHI) and Christopher Myers
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *---------------------------------------------------------------------------
+ *
+ * A compact binary file format for captured ir_segment_t streams, so that
+ * recordings from the field can be kept and replayed into the decoders on a
+ * regular computer. All multi-byte fields are little endian.
+ *
+ * File header:
+ *
+ *   offset  size  field
+ *        0     4  magic, "BTIR"
+ *        4     1  version, IR_TRACE_VERSION
+ *        5     1  flags, IR_TRACE_F_*
+ *        6     1  polarity, an ir_polarity_t
+ *        7     1  source_length
+ *        8     4  tick_period_ns, the length of one duration unit
+ *       12     n  source, source_length bytes of text saying where the
+ *                 trace came from (not NUL terminated)
+ *
+ * Then any number of frames, each:
+ *
+ *   size  field
+ *      2  count, the number of segments
+ *      4  timestamp, only if IR_TRACE_F_TIMESTAMPS is set. The time of the
+ *         frame's leading edge in ticks since the capture began. It wraps,
+ *         so only the difference between two frames means anything.
+ *    2*n  count segment durations, in ticks
+ *
+ * There is no frame index or trailer; the file ends after the last frame.
+ * A frame is whatever the capturing decoder saw between two end-of-frame
+ * events, exactly as a buffering decoder would record it: no leading edge,
+ * one duration per segment.
+ *
+ * See extras/trace/ir_trace_tool.cpp for how to build against this, and
+ * examples/TraceCapture for capturing on the board.
+ */
+#ifndef IR_TRACE_H
+#define IR_TRACE_H
+
+#include <stdio.h>
+#include <BTHI_IR_Decoder.h>
+
+#define IR_TRACE_MAGIC              "BTIR"
+#define IR_TRACE_VERSION            1
+
+/* Header flags */
+#define IR_TRACE_F_TIMESTAMPS       0x01
+
+/* Error codes. IR_E_OK (0) means success. */
+#define IR_TRACE_E_END              -1
+#define IR_TRACE_E_IO               -2
+#define IR_TRACE_E_BAD_FORMAT       -3
+#define IR_TRACE_E_FRAME_TOO_LONG   -4
+
+typedef struct {
+	uint8_t flags;
+	ir_polarity_t polarity;
+	uint32_t tick_period_ns;
+	char source[256];
+} ir_trace_header_t;
+
+extern void irTraceInitHeader(ir_trace_header_t *header, const char *source,
+		uint8_t flags);
+extern int8_t irTraceWriteHeader(FILE *file, const ir_trace_header_t *header);
+extern int8_t irTraceWriteFrame(FILE *file, const ir_trace_header_t *header,
+		uint32_t timestamp, const ir_segment_t *segments, uint16_t count);
+extern int8_t irTraceReadHeader(FILE *file, ir_trace_header_t *header);
+extern int8_t irTraceReadFrame(FILE *file, const ir_trace_header_t *header,
+		uint32_t *timestamp, ir_segment_t *segments, uint16_t max_segments,
+		uint16_t *count);
+
+/**
+ * Called by irTraceReplay() once the end of each frame has been signalled,
+ * when the application would next look at the decoder.
+ */
+typedef void (*ir_trace_frame_callback_t)(void *context);
+
+extern int8_t irTraceReplay(FILE *file, const ir_trace_header_t *header,
+		IR_StreamDecoder *decoder, uint8_t real_time,
+		ir_trace_frame_callback_t callback, void *context);
+
+#endif
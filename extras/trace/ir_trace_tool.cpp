@@ -0,0 +1,900 @@
+/*---------------------------------------------------------------------------
+ * Streaming Infrared Decoder Library - trace file tool
+ *
+ * Copyright (c) 2013, Bryan Thomas (BTHI) and Christopher Myers
+ * All Rights Reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *---------------------------------------------------------------------------
+ *
+ * Command line tool for trace files (see ir_trace.h). Build it from the
+ * library directory:
+ *
+ *  g++ -O2 -I. -Iextras/trace extras/trace/ir_trace_tool.cpp \
+ *      extras/trace/ir_trace.cpp BTHI_IR_Decoder.cpp BTHI_IR_Hal_Host.cpp \
+ *      -lpthread -o ir_trace_tool
+ *
+ * Commands:
+ *
+ *  ir_trace_tool info TRACE
+ *      Prints the header and the length of every frame.
+ *
+ *  ir_trace_tool dump TRACE
+ *      Prints every frame the way IR_BufferingStreamDecoder::debugPrintFrame()
+ *      does, so it can be pasted into notes like doc/protocol_info.md.
+ *
+ *  ir_trace_tool import TEXT TRACE [SOURCE]
+ *      Converts debugPrintFrame() output (lines of "index: duration") to a
+ *      trace. Other lines are ignored, and a new frame starts whenever the
+ *      index goes back to 0. Use "-" for TEXT to read stdin.
+ *
+ *  ir_trace_tool replay TRACE [--real-time]
+ *      Plays the trace into an IR_StreamDispatcher for the Samsung and Apple
+ *      protocols, and prints what each frame decoded to.
+ *
+ *  ir_trace_tool quantize [--jitter US] [--copies N] TRACE...
+ *      Decodes every frame as Samsung and Apple twice, once from 16-bit
+ *      segments and once from the 8-bit codes of irQuantizeTicks(), and
+ *      reports the frames where the two disagree and the largest rounding
+ *      error. With --jitter, each frame is also decoded N more times
+ *      (default 10) with every duration moved by up to US microseconds, and
+ *      both decodes of each copy are scored against the recorded frame's.
+ *
+ *  ir_trace_tool symbols TRACE...
+ *      Classifies every frame into IR_SymbolStreamDecoder symbols and checks
+ *      that decodeFrameSymbols() decodes every frame that
+ *      decodeFramePulseDistance() decodes from the durations, to the same
+ *      code, for Samsung and Apple. Then checks the lookup table
+ *      behind it, irDecodeSymbolBits(), against a one bit at a time loop on
+ *      random symbol streams of every length, and times the two. The
+ *      timings are for the host; they say nothing about the AVR, where
+ *      examples/SymbolDecodeBenchmark has to be run instead.
+ *
+ *  ir_trace_tool tree TRACE...
+ *      Prints the IR_DecisionTree for Samsung and Apple: which header marks
+ *      and spaces lead to which protocol. Then decodes every frame with it
+ *      and with decodeFrameAny(), checks that the tree decodes every frame
+ *      decodeFrameAny() does, to the same result, and reports how many
+ *      compares each took to pick the protocol. The code the tree compiles
+ *      to can be sized with nm, e.g. for a sketch:
+ *
+ *          avr-nm -C -S --size-sort sketch.elf | grep IR_Tree
+ *
+ * To capture a trace from the board, load examples/TraceCapture and save
+ * what it writes to the serial port, for example:
+ *
+ *  stty -F /dev/ttyACM0 115200 raw && cat /dev/ttyACM0 > capture.irt
+ *
+ * extras/trace/corpus has traces to regress against.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <ir_trace.h>
+#include <BTHI_IR_DecisionTree.h>
+
+/* Longest frame the tool handles */
+#define TOOL_MAX_SEGMENTS   1024
+
+/* Random streams irDecodeSymbolBits() is checked against, and how many times
+ * each of the timed decodes is run
+ */
+#define TOOL_SYMBOL_CHECKS  100000
+#define TOOL_SYMBOL_RUNS    2000000
+
+static ir_segment_t g_segments[TOOL_MAX_SEGMENTS];
+static ir_segment_t g_jittered[TOOL_MAX_SEGMENTS];
+static ir_qsegment_t g_qsegments[TOOL_MAX_SEGMENTS];
+static uint8_t g_symbols[IR_SYMBOL_BYTES(TOOL_MAX_SEGMENTS)];
+
+static int usage(void) {
+    fprintf(stderr,
+        "usage: ir_trace_tool info TRACE\n"
+        "       ir_trace_tool dump TRACE\n"
+        "       ir_trace_tool import TEXT TRACE [SOURCE]\n"
+        "       ir_trace_tool replay TRACE [--real-time]\n"
+        "       ir_trace_tool quantize [--jitter US] [--copies N] TRACE...\n"
+        "       ir_trace_tool symbols TRACE...\n"
+        "       ir_trace_tool tree TRACE...\n");
+    return 2;
+}
+
+static const char *errorString(int8_t res) {
+    switch (res) {
+    case IR_TRACE_E_IO:
+        return "read or write failed";
+    case IR_TRACE_E_BAD_FORMAT:
+        return "not a trace file";
+    case IR_TRACE_E_FRAME_TOO_LONG:
+        return "frame too long";
+    }
+    return "unknown error";
+}
+
+/**
+ * Opens a trace and reads its header, printing an error if that fails.
+ *
+ * Return: The open file, or NULL.
+ */
+static FILE *openTrace(const char *path, ir_trace_header_t *header) {
+    FILE *file = fopen(path, "rb");
+    int8_t res;
+
+    if (NULL == file) {
+        perror(path);
+        return NULL;
+    }
+
+    res = irTraceReadHeader(file, header);
+    if (IR_E_OK != res) {
+        fprintf(stderr, "%s: %s\n", path, errorString(res));
+        fclose(file);
+        return NULL;
+    }
+
+    return file;
+}
+
+static int commandInfo(const char *path, uint8_t dump) {
+    ir_trace_header_t header;
+    uint32_t timestamp;
+    uint32_t frames = 0;
+    uint16_t count;
+    int8_t res;
+    FILE *file;
+
+    file = openTrace(path, &header);
+    if (NULL == file) {
+        return 1;
+    }
+
+    printf("Source: %s\n", header.source);
+    printf("Tick Period: %luns\n", (unsigned long)header.tick_period_ns);
+    printf("Polarity: %s\n", (IR_POLARITY_LOW == header.polarity) ? "low"
+        : (IR_POLARITY_HIGH == header.polarity) ? "high" : "auto");
+    printf("Timestamps: %s\n",
+        (0 != (header.flags & IR_TRACE_F_TIMESTAMPS)) ? "yes" : "no");
+
+    for (;;) {
+        res = irTraceReadFrame(file, &header, &timestamp, g_segments,
+            TOOL_MAX_SEGMENTS, &count);
+        if (IR_TRACE_E_END == res) {
+            break;
+        }
+
+        printf("\nFrame %lu: %u segments", (unsigned long)frames, count);
+        if (0 != (header.flags & IR_TRACE_F_TIMESTAMPS)) {
+            printf(" at %lu", (unsigned long)timestamp);
+        }
+        printf("\n");
+        frames++;
+
+        if (IR_TRACE_E_FRAME_TOO_LONG == res) {
+            printf("  (too long to show)\n");
+            continue;
+        } else if (IR_E_OK != res) {
+            fprintf(stderr, "%s: %s\n", path, errorString(res));
+            fclose(file);
+            return 1;
+        }
+
+        if (0 != dump) {
+            for (uint16_t i = 0; i < count; i++) {
+                printf("    %u: %u\n", i, g_segments[i].duration);
+            }
+        }
+    }
+
+    printf("\n%lu frames\n", (unsigned long)frames);
+    fclose(file);
+    return 0;
+}
+
+static int commandImport(const char *text_path, const char *trace_path,
+        const char *source) {
+    ir_trace_header_t header;
+    char line[128];
+    unsigned index;
+    unsigned duration;
+    uint16_t count = 0;
+    uint32_t frames = 0;
+    int8_t res = IR_E_OK;
+    uint8_t bad_line = 0;
+    uint8_t failed;
+    FILE *in;
+    FILE *out;
+
+    in = (0 == strcmp(text_path, "-")) ? stdin : fopen(text_path, "r");
+    if (NULL == in) {
+        perror(text_path);
+        return 1;
+    }
+
+    out = fopen(trace_path, "wb");
+    if (NULL == out) {
+        perror(trace_path);
+        if (stdin != in) {
+            fclose(in);
+        }
+        return 1;
+    }
+
+    irTraceInitHeader(&header, (NULL != source) ? source : text_path, 0);
+    res = irTraceWriteHeader(out, &header);
+
+    while ((IR_E_OK == res) && (NULL != fgets(line, sizeof(line), in))) {
+        if (2 != sscanf(line, " %u: %u", &index, &duration)) {
+            continue;
+        }
+
+        if ((0 == index) && (0 != count)) {
+            res = irTraceWriteFrame(out, &header, 0, g_segments, count);
+            frames++;
+            count = 0;
+        }
+
+        if ((index != count) || (count >= TOOL_MAX_SEGMENTS)
+                || (duration > 0xFFFF)) {
+            fprintf(stderr, "%s: unexpected line: %s", text_path, line);
+            bad_line = 1;
+            break;
+        }
+        g_segments[count++].duration = (uint16_t)duration;
+    }
+
+    if ((0 == bad_line) && (IR_E_OK == res) && (0 != count)) {
+        res = irTraceWriteFrame(out, &header, 0, g_segments, count);
+        frames++;
+    }
+
+    if (stdin != in) {
+        fclose(in);
+    }
+
+    failed = (0 != fclose(out)) || (IR_E_OK != res) || (0 != bad_line);
+    if ((0 == bad_line) && (0 != failed)) {
+        fprintf(stderr, "%s: %s\n", trace_path, errorString(IR_TRACE_E_IO));
+    }
+
+    /* Don't leave half a trace behind */
+    if (0 != failed) {
+        remove(trace_path);
+        return 1;
+    }
+
+    printf("Wrote %lu frames to %s\n", (unsigned long)frames, trace_path);
+    return 0;
+}
+
+/* The decoders used by the replay command */
+typedef struct {
+    IR_PulseDistanceStreamMachine<IR_ProtocolSamsung> samsung;
+    IR_PulseDistanceStreamMachine<IR_ProtocolApple> apple;
+    IR_StreamDispatcher dispatcher;
+    uint32_t frames;
+    uint32_t matched;
+} replay_state_t;
+
+static void replayFrame(void *context) {
+    replay_state_t *state = (replay_state_t *)context;
+    IR_StreamMachine *machine;
+
+    printf("Frame %lu: ", (unsigned long)state->frames++);
+    if (state->dispatcher.isFrameAvailable()) {
+        machine = state->dispatcher.getMatchedMachine();
+        printf("%s 0x%08lX\n", (machine == &state->samsung) ? "Samsung"
+            : "Apple", (unsigned long)machine->getData());
+        state->matched++;
+        state->dispatcher.readyForNextFrame();
+    } else {
+        printf("no match\n");
+    }
+}
+
+static int commandReplay(const char *path, uint8_t real_time) {
+    static replay_state_t state;
+    IR_StreamMachine *machines[] = { &state.samsung, &state.apple };
+    ir_trace_header_t header;
+    int8_t res;
+    FILE *file;
+
+    file = openTrace(path, &header);
+    if (NULL == file) {
+        return 1;
+    }
+
+    state.dispatcher.setMachines(machines, 2);
+    res = irTraceReplay(file, &header, &state.dispatcher, real_time,
+        replayFrame, &state);
+    fclose(file);
+
+    if (IR_E_OK != res) {
+        fprintf(stderr, "%s: %s\n", path, errorString(res));
+        return 1;
+    }
+
+    printf("%lu of %lu frames matched, %u unmatched\n",
+        (unsigned long)state.matched, (unsigned long)state.frames,
+        state.dispatcher.getUnmatchedFrameCount());
+    return 0;
+}
+
+typedef struct decode_result_tag {
+    int8_t res;
+    uint8_t protocol;
+    uint32_t data;
+} decode_result_t;
+
+typedef struct quantize_stats_tag {
+    uint32_t frames;
+    uint32_t correct;
+    uint32_t quantized_correct;
+    uint32_t skipped;
+    uint16_t max_error_pct10;
+} quantize_stats_t;
+
+/**
+ * Decodes a frame as Samsung, then Apple, keeping the first result that
+ * isn't an error.
+ */
+template<class Segment>
+static void decodeAny(const Segment *segments, uint8_t count,
+        decode_result_t *result) {
+    result->protocol = 0;
+    result->data = 0;
+    result->res = decodeFramePulseDistance<IR_ProtocolSamsung>(segments, count,
+        &result->data);
+    if (IR_E_OK <= result->res) {
+        return;
+    }
+
+    result->protocol = 1;
+    result->data = 0;
+    result->res = decodeFramePulseDistance<IR_ProtocolApple>(segments, count,
+        &result->data);
+}
+
+static uint8_t sameResult(const decode_result_t *a, const decode_result_t *b) {
+    if (a->res != b->res) {
+        return 0;
+    }
+    return (IR_E_OK > a->res)
+        || ((a->protocol == b->protocol) && (a->data == b->data));
+}
+
+/**
+ * Decodes a frame from 16-bit segments and from their quantized codes, and
+ * counts each decode that gives the expected result.
+ *
+ * Parameters:
+ *      expected: What the frame should decode to, or NULL to expect what
+ *          the 16-bit segments decode to.
+ *
+ * Return: Non-zero if the quantized decode wasn't the expected result.
+ */
+static uint8_t compareFrame(const ir_segment_t *segments, uint8_t count,
+        const decode_result_t *expected, quantize_stats_t *stats) {
+    decode_result_t result, quantized;
+    uint16_t restored;
+    uint32_t error;
+
+    for (uint8_t i = 0; i < count; i++) {
+        irStoreSegment(&g_qsegments[i], segments[i].duration);
+        restored = irDequantizeTicks(g_qsegments[i].duration);
+        if (16 <= segments[i].duration) {
+            error = (restored > segments[i].duration)
+                ? restored - segments[i].duration
+                : segments[i].duration - restored;
+            error = (error * 1000) / segments[i].duration;
+            if (error > stats->max_error_pct10) {
+                stats->max_error_pct10 = (uint16_t)error;
+            }
+        }
+    }
+
+    decodeAny(segments, count, &result);
+    decodeAny(g_qsegments, count, &quantized);
+    if (NULL == expected) {
+        expected = &result;
+    }
+
+    stats->frames++;
+    if (0 != sameResult(&result, expected)) {
+        stats->correct++;
+    }
+    if (0 != sameResult(&quantized, expected)) {
+        stats->quantized_correct++;
+        return 0;
+    }
+
+    return 1;
+}
+
+static void printStats(const char *label, const quantize_stats_t *stats) {
+    printf("%s: %lu frames, %lu decoded as expected from 16-bit segments, "
+        "%lu from quantized", label, (unsigned long)stats->frames,
+        (unsigned long)stats->correct,
+        (unsigned long)stats->quantized_correct);
+    if (0 != stats->skipped) {
+        printf(", %lu too long", (unsigned long)stats->skipped);
+    }
+    printf(", worst rounding %u.%u%%\n", stats->max_error_pct10 / 10,
+        stats->max_error_pct10 % 10);
+}
+
+static int commandQuantize(int argc, char **argv) {
+    quantize_stats_t exact, jittered;
+    decode_result_t recorded;
+    ir_trace_header_t header;
+    uint32_t jitter_ticks;
+    uint32_t timestamp;
+    uint32_t frames;
+    uint32_t duration;
+    int32_t offset;
+    long jitter_us = 0;
+    long copies = 10;
+    uint16_t count;
+    int8_t res;
+    FILE *file;
+    int i;
+
+    for (i = 2; (i + 1 < argc) && ('-' == argv[i][0]); i += 2) {
+        if (0 == strcmp(argv[i], "--jitter")) {
+            jitter_us = strtol(argv[i + 1], NULL, 10);
+        } else if (0 == strcmp(argv[i], "--copies")) {
+            copies = strtol(argv[i + 1], NULL, 10);
+        } else {
+            return usage();
+        }
+    }
+    if ((i >= argc) || (0 > jitter_us) || (0 > copies)) {
+        return usage();
+    }
+
+    memset(&exact, 0, sizeof(exact));
+    memset(&jittered, 0, sizeof(jittered));
+    srand(1);
+
+    for (; i < argc; i++) {
+        file = openTrace(argv[i], &header);
+        if (NULL == file) {
+            return 1;
+        }
+        jitter_ticks = ((uint32_t)jitter_us * 1000) / header.tick_period_ns;
+
+        for (frames = 0; ; frames++) {
+            res = irTraceReadFrame(file, &header, &timestamp, g_segments,
+                TOOL_MAX_SEGMENTS, &count);
+            if (IR_TRACE_E_END == res) {
+                break;
+            } else if ((IR_TRACE_E_FRAME_TOO_LONG == res) || (0xFF < count)) {
+                exact.skipped++;
+                continue;
+            } else if (IR_E_OK != res) {
+                fprintf(stderr, "%s: %s\n", argv[i], errorString(res));
+                fclose(file);
+                return 1;
+            }
+
+            decodeAny(g_segments, (uint8_t)count, &recorded);
+            if (0 != compareFrame(g_segments, (uint8_t)count, NULL, &exact)) {
+                printf("%s frame %lu: differs when quantized\n", argv[i],
+                    (unsigned long)frames);
+            }
+
+            if (0 == jitter_ticks) {
+                continue;
+            }
+            for (long copy = 0; copy < copies; copy++) {
+                for (uint16_t j = 0; j < count; j++) {
+                    offset = (int32_t)(rand() % (2 * jitter_ticks + 1))
+                        - (int32_t)jitter_ticks;
+                    duration = g_segments[j].duration;
+                    duration = ((int32_t)duration + offset < 1) ? 1
+                        : (uint32_t)((int32_t)duration + offset);
+                    g_jittered[j].duration = (0xFFFF < duration)
+                        ? 0xFFFF : (uint16_t)duration;
+                }
+                compareFrame(g_jittered, (uint8_t)count, &recorded, &jittered);
+            }
+        }
+
+        fclose(file);
+    }
+
+    printStats("Recorded", &exact);
+    if (0 != jittered.frames) {
+        printf("Jittered by up to %ldus, ", jitter_us);
+        printStats("copies", &jittered);
+    }
+
+    return (exact.quantized_correct != exact.frames) ? 1 : 0;
+}
+
+static uint64_t nowNs(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/**
+ * What irDecodeSymbolBits() replaced: one symbol, and one shift, per bit.
+ */
+static uint32_t decodeSymbolBitsOneAtATime(const uint8_t *symbols,
+        uint8_t num_bits) {
+    uint32_t datagram = 0;
+
+    for (uint8_t i = 3; i < 2 + (2 * num_bits); i += 2) {
+        datagram <<= 1;
+        if (IR_SYMBOL_SHORT != irGetSymbol(symbols, i)) {
+            datagram |= 1;
+        }
+    }
+
+    return datagram;
+}
+
+static void packSymbols(const ir_symbol_thresholds_t *thresholds,
+        const ir_segment_t *segments, uint16_t count) {
+    memset(g_symbols, 0, IR_SYMBOL_BYTES(count));
+    for (uint16_t i = 0; i < count; i++) {
+        g_symbols[i >> 2] |= (uint8_t)(irClassifyTicks(thresholds,
+            segments[i].duration) << ((i & 3) << 1));
+    }
+}
+
+template<class Protocol>
+static uint8_t compareSymbolDecode(const ir_segment_t *segments,
+        uint8_t count) {
+    static const ir_symbol_thresholds_t thresholds =
+        IR_SYMBOL_THRESHOLDS(Protocol);
+    const uint16_t preamble[2] = {
+        (count > 0) ? segments[0].duration : (uint16_t)0,
+        (count > 1) ? segments[1].duration : (uint16_t)0 };
+    uint32_t data = 0;
+    uint32_t symbol_data = 0;
+    int8_t res, symbol_res;
+
+    packSymbols(&thresholds, segments, count);
+    res = decodeFramePulseDistance<Protocol>(segments, count, &data);
+    symbol_res = decodeFrameSymbols<Protocol>(g_symbols, count, preamble,
+        &symbol_data);
+
+    /* Symbols don't hold each bit to its window, so they accept more frames
+     * than the windows do. What matters is that they decode every frame the
+     * windows do, to the same thing.
+     */
+    if (IR_E_OK > res) {
+        return 1;
+    }
+    return (res == symbol_res) && (data == symbol_data);
+}
+
+static int commandSymbols(int argc, char **argv) {
+    static const ir_symbol_thresholds_t thresholds =
+        IR_SYMBOL_THRESHOLDS(IR_ProtocolSamsung);
+    ir_trace_header_t header;
+    uint32_t timestamp;
+    uint32_t frames = 0;
+    uint32_t agreed = 0;
+    uint32_t mismatched = 0;
+    volatile uint32_t sink = 0;
+    uint64_t start, loop_ns, table_ns;
+    uint16_t count;
+    int8_t res;
+    FILE *file;
+
+    for (int i = 2; i < argc; i++) {
+        file = openTrace(argv[i], &header);
+        if (NULL == file) {
+            return 1;
+        }
+
+        for (;;) {
+            res = irTraceReadFrame(file, &header, &timestamp, g_segments,
+                TOOL_MAX_SEGMENTS, &count);
+            if (IR_TRACE_E_END == res) {
+                break;
+            } else if ((IR_TRACE_E_FRAME_TOO_LONG == res) || (0xFF < count)) {
+                continue;
+            } else if (IR_E_OK != res) {
+                fprintf(stderr, "%s: %s\n", argv[i], errorString(res));
+                fclose(file);
+                return 1;
+            }
+
+            frames++;
+            if ((0 != compareSymbolDecode<IR_ProtocolSamsung>(g_segments,
+                    (uint8_t)count))
+                    && (0 != compareSymbolDecode<IR_ProtocolApple>(g_segments,
+                    (uint8_t)count))) {
+                agreed++;
+            } else {
+                printf("%s: a frame decodes differently from symbols\n",
+                    argv[i]);
+            }
+        }
+
+        fclose(file);
+    }
+
+    printf("Recorded: %lu of %lu frames decode the same from symbols\n",
+        (unsigned long)agreed, (unsigned long)frames);
+
+    srand(1);
+    for (uint32_t n = 0; n < TOOL_SYMBOL_CHECKS; n++) {
+        uint8_t num_bits = (uint8_t)(1 + (n % 32));
+
+        for (uint8_t i = 0; i < IR_SYMBOL_BYTES(2 + (2 * 32)); i++) {
+            g_symbols[i] = (uint8_t)rand();
+        }
+        if (irDecodeSymbolBits(g_symbols, num_bits)
+                != decodeSymbolBitsOneAtATime(g_symbols, num_bits)) {
+            mismatched++;
+        }
+    }
+    printf("Random: %lu of %lu streams differ from one bit at a time\n",
+        (unsigned long)mismatched, (unsigned long)TOOL_SYMBOL_CHECKS);
+
+    /* Time the bit loops on a real frame if there was one */
+    if (0 != frames) {
+        packSymbols(&thresholds, g_segments, count);
+    }
+
+    start = nowNs();
+    for (uint32_t n = 0; n < TOOL_SYMBOL_RUNS; n++) {
+        sink += decodeSymbolBitsOneAtATime(g_symbols, 32);
+        g_symbols[1] ^= (uint8_t)sink & 0x01;
+    }
+    loop_ns = nowNs() - start;
+
+    start = nowNs();
+    for (uint32_t n = 0; n < TOOL_SYMBOL_RUNS; n++) {
+        sink += irDecodeSymbolBits(g_symbols, 32);
+        g_symbols[1] ^= (uint8_t)sink & 0x01;
+    }
+    table_ns = nowNs() - start;
+
+    printf("One bit at a time: %.1fns per 32 bits\n",
+        (double)loop_ns / TOOL_SYMBOL_RUNS);
+    printf("Lookup table:      %.1fns per 32 bits (%.1fx)\n",
+        (double)table_ns / TOOL_SYMBOL_RUNS, (double)loop_ns / table_ns);
+
+    return ((agreed != frames) || (0 != mismatched)) ? 1 : 0;
+}
+
+typedef IR_DecisionTree<
+    IR_TreeProtocol<IR_ProtocolSamsung, IR_PROTOCOL_SAMSUNG>,
+    IR_TreeProtocol<IR_ProtocolApple, IR_PROTOCOL_APPLE> > tool_tree_t;
+
+/* The tree's preambles in bit order, and their windows in the order
+ * decodeFrameAny() effectively tries them.
+ */
+static const char *g_preamble_names[] = {
+    "Samsung", "Samsung repeat", "Apple", "Apple repeat"
+};
+
+typedef IR_PulseDistanceWindows<IR_ProtocolSamsung> samsung_windows_t;
+typedef IR_PulseDistanceWindows<IR_ProtocolApple> apple_windows_t;
+
+static const uint16_t g_preamble_windows[][4] = {
+    { samsung_windows_t::RepeatMark::lo, samsung_windows_t::RepeatMark::hi,
+        samsung_windows_t::RepeatSpace::lo,
+        samsung_windows_t::RepeatSpace::hi },
+    { samsung_windows_t::HeaderMark::lo, samsung_windows_t::HeaderMark::hi,
+        samsung_windows_t::HeaderSpace::lo,
+        samsung_windows_t::HeaderSpace::hi },
+    { apple_windows_t::RepeatMark::lo, apple_windows_t::RepeatMark::hi,
+        apple_windows_t::RepeatSpace::lo, apple_windows_t::RepeatSpace::hi },
+    { apple_windows_t::HeaderMark::lo, apple_windows_t::HeaderMark::hi,
+        apple_windows_t::HeaderSpace::lo, apple_windows_t::HeaderSpace::hi }
+};
+
+/* Compares a binary search of num_points edges makes at most */
+static uint8_t searchDepth(uint8_t num_points) {
+    uint8_t depth = 0;
+
+    while ((1U << depth) < num_points + 1U) {
+        depth++;
+    }
+    return depth;
+}
+
+static void printInterval(uint8_t stage, uint32_t start, uint32_t end,
+        uint32_t mask, uint8_t next_depth) {
+    printf("%s%-5s %5lu-%luus:", (0 == stage) ? "  " : "    ",
+        (0 == stage) ? "mark" : "space",
+        (unsigned long)(start * IR_TICK_PERIOD_NS / 1000),
+        (unsigned long)((end - 1) * IR_TICK_PERIOD_NS / 1000));
+    if (0 == stage) {
+        printf(" then at most %u compares for the space\n", next_depth);
+        return;
+    }
+    for (uint8_t i = 0; i < 4; i++) {
+        if (0 != (mask & (1UL << i))) {
+            printf(" %s", g_preamble_names[i]);
+        }
+    }
+    printf("\n");
+}
+
+/**
+ * Prints the intervals of a stage of the tree that lead anywhere, and under
+ * each header mark interval, the search of the spaces it leads to.
+ */
+template <class Stage, uint8_t I = 0, uint8_t end = (I > Stage::num_points)>
+struct TreePrinter {
+    typedef typename Stage::template Interval<I> Interval;
+    typedef IR_TreeStage<typename Stage::list_t, 1, Interval::mask> Next;
+
+    static void print(void) {
+        if (0 != Interval::mask) {
+            printInterval(Stage::stage, Interval::start,
+                Stage::template Interval<I + 1>::start, Interval::mask,
+                searchDepth(Next::num_points));
+            if (0 == Stage::stage) {
+                TreePrinter<Next>::print();
+            }
+        }
+        TreePrinter<Stage, I + 1>::print();
+    }
+};
+
+template <class Stage, uint8_t I>
+struct TreePrinter<Stage, I, 1> {
+    static void print(void) {
+    }
+};
+
+/**
+ * What finding the preamble costs checking one window at a time, as
+ * decodeFrameAny() does: one compare if the segment is below the window,
+ * two otherwise.
+ */
+static uint8_t countLinearCompares(uint16_t mark, uint16_t space) {
+    uint8_t compares = 0;
+
+    for (uint8_t i = 0; i < 4; i++) {
+        const uint16_t *window = g_preamble_windows[i];
+
+        compares += (mark < window[0]) ? 1 : 2;
+        if ((mark < window[0]) || (mark > window[1])) {
+            continue;
+        }
+        compares += (space < window[2]) ? 1 : 2;
+        if ((space >= window[2]) && (space <= window[3])) {
+            break;
+        }
+    }
+
+    return compares;
+}
+
+static int commandTree(int argc, char **argv) {
+    ir_trace_header_t header;
+    ir_decode_result_t any_result, tree_result;
+    uint32_t timestamp;
+    uint32_t frames = 0;
+    uint32_t decoded = 0;
+    uint32_t agreed = 0;
+    uint32_t tree_compares = 0, linear_compares = 0;
+    uint8_t tree_max = 0, linear_max = 0;
+    uint8_t compares;
+    uint16_t count;
+    int8_t res, any_res, tree_res;
+    FILE *file;
+
+    printf("Decision tree for Samsung and Apple, at most %u compares for "
+        "the mark:\n",
+        searchDepth(tool_tree_t::MarkStage::num_points));
+    TreePrinter<tool_tree_t::MarkStage>::print();
+
+    for (int i = 2; i < argc; i++) {
+        file = openTrace(argv[i], &header);
+        if (NULL == file) {
+            return 1;
+        }
+
+        for (;;) {
+            res = irTraceReadFrame(file, &header, &timestamp, g_segments,
+                TOOL_MAX_SEGMENTS, &count);
+            if (IR_TRACE_E_END == res) {
+                break;
+            } else if ((IR_TRACE_E_FRAME_TOO_LONG == res) || (0xFF < count)
+                    || (count < 2)) {
+                continue;
+            } else if (IR_E_OK != res) {
+                fprintf(stderr, "%s: %s\n", argv[i], errorString(res));
+                fclose(file);
+                return 1;
+            }
+
+            frames++;
+            compares = tool_tree_t::countCompares(g_segments[0].duration,
+                g_segments[1].duration);
+            tree_compares += compares;
+            if (compares > tree_max) {
+                tree_max = compares;
+            }
+            compares = countLinearCompares(g_segments[0].duration,
+                g_segments[1].duration);
+            linear_compares += compares;
+            if (compares > linear_max) {
+                linear_max = compares;
+            }
+
+            memset(&any_result, 0, sizeof(any_result));
+            memset(&tree_result, 0, sizeof(tree_result));
+            any_res = decodeFrameAny(g_segments, (uint8_t)count, &any_result);
+            tree_res = tool_tree_t::decode(g_segments, (uint8_t)count,
+                &tree_result);
+            if (IR_E_OK > any_res) {
+                continue;
+            }
+
+            decoded++;
+            if ((any_res == tree_res)
+                    && (0 == memcmp(&any_result, &tree_result,
+                        sizeof(any_result)))) {
+                agreed++;
+            } else {
+                printf("%s: a frame decodes differently with the tree\n",
+                    argv[i]);
+            }
+        }
+
+        fclose(file);
+    }
+
+    printf("%lu of %lu frames decodeFrameAny() decodes, decode the same\n",
+        (unsigned long)agreed, (unsigned long)decoded);
+    if (0 != frames) {
+        printf("Compares to pick the protocol, over %lu frames:\n",
+            (unsigned long)frames);
+        printf("  decision tree:       %.2f average, %u at most\n",
+            (double)tree_compares / frames, tree_max);
+        printf("  window at a time:    %.2f average, %u at most\n",
+            (double)linear_compares / frames, linear_max);
+    }
+
+    return (agreed != decoded) ? 1 : 0;
+}
+
+int main(int argc, char **argv) {
+    if ((3 == argc) && (0 == strcmp(argv[1], "info"))) {
+        return commandInfo(argv[2], 0);
+    } else if ((3 == argc) && (0 == strcmp(argv[1], "dump"))) {
+        return commandInfo(argv[2], 1);
+    } else if (((4 == argc) || (5 == argc))
+            && (0 == strcmp(argv[1], "import"))) {
+        return commandImport(argv[2], argv[3], (5 == argc) ? argv[4] : NULL);
+    } else if ((3 == argc) && (0 == strcmp(argv[1], "replay"))) {
+        return commandReplay(argv[2], 0);
+    } else if ((4 == argc) && (0 == strcmp(argv[1], "replay"))
+            && (0 == strcmp(argv[3], "--real-time"))) {
+        return commandReplay(argv[2], 1);
+    } else if ((3 <= argc) && (0 == strcmp(argv[1], "quantize"))) {
+        return commandQuantize(argc, argv);
+    } else if ((3 <= argc) && (0 == strcmp(argv[1], "symbols"))) {
+        return commandSymbols(argc, argv);
+    } else if ((3 <= argc) && (0 == strcmp(argv[1], "tree"))) {
+        return commandTree(argc, argv);
+    }
+
+    return usage();
+}